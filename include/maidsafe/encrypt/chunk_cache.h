@@ -0,0 +1,90 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_CHUNK_CACHE_H_
+#define MAIDSAFE_ENCRYPT_CHUNK_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/encrypt/data_map.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Decrypted chunks keyed by chunk name, for sharing between SelfDecryptors.  Up to |capacity| bytes
+// are held, the least recently used chunk being evicted first.  It's safe to use from any thread:
+// the chunks are spread over several shards, each with its own lock held only for a lookup or an
+// insertion, so concurrent readers rarely wait on each other.  Chunks are handed out as shared
+// pointers, so eviction never pulls one from under a reader still using it.  GetOrLoad lets only
+// one reader load a missing chunk, any others wanting it meanwhile waiting for that load.
+class ChunkCache {
+ public:
+  using Chunk = std::shared_ptr<const ByteVector>;
+
+  explicit ChunkCache(uint64_t capacity);
+  ChunkCache(const ChunkCache&) = delete;
+  ChunkCache& operator=(const ChunkCache&) = delete;
+
+  // Returns nullptr if the chunk named |name| isn't cached.
+  Chunk Get(const ByteVector& name);
+  // Chunks bigger than a shard's share of the capacity aren't cached.
+  void Put(const ByteVector& name, Chunk chunk);
+  // Returns the chunk named |name|, calling |load| for it and caching the result if it's missing.
+  // Callers wanting the same chunk while it's being loaded wait for that call rather than making
+  // their own, and receive any exception it throws.
+  Chunk GetOrLoad(const ByteVector& name, const std::function<Chunk()>& load);
+  uint64_t capacity() const { return kCapacity_; }
+  // The bytes of decrypted data currently held.
+  uint64_t size() const;
+
+ private:
+  typedef std::list<std::pair<ByteVector, Chunk>> Entries;  // Most recently used first.
+  struct Shard {
+    Shard() : mutex(), entries(), index(), loading(), size(0) {}
+    mutable std::mutex mutex;
+    Entries entries;
+    std::map<ByteVector, Entries::iterator> index;
+    std::map<ByteVector, std::shared_future<Chunk>> loading;
+    uint64_t size;
+  };
+  static const size_t kShardCount = 16;
+
+  Shard& ShardFor(const ByteVector& name);
+  // Needs |shard|'s mutex held.
+  Chunk Find(Shard& shard, const ByteVector& name);
+  void Insert(Shard& shard, const ByteVector& name, Chunk chunk);
+
+  const uint64_t kCapacity_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_CHUNK_CACHE_H_
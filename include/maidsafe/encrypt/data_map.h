@@ -67,6 +67,10 @@ struct DataMap {
   EncryptionAlgorithm self_encryption_version;
   std::vector<ChunkDetails> chunks;
   ByteVector content;  // Whole data item, if small enough
+  // Optional root of a MerkleTree over the chunks' hashes.  If set, it is kept up to date when the
+  // data map is modified by a SelfEncryptor, until the file shrinks small enough to be held as
+  // content, which clears it.
+  ByteVector merkle_root;
 };
 
 bool operator==(const DataMap& lhs, const DataMap& rhs);
@@ -20,7 +20,11 @@
 #define MAIDSAFE_ENCRYPT_DATA_MAP_ENCRYPTOR_H_
 
 #include <cstdint>
+#include <istream>
+#include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 #include "maidsafe/encrypt/data_map.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/crypto.h"
@@ -30,7 +34,8 @@ namespace maidsafe {
 namespace encrypt {
 enum class EncryptionAlgorithm : uint32_t {
   kSelfEncryptionVersion0 = 0,
-  kDataMapEncryptionVersion0
+  kDataMapEncryptionVersion0,
+  kDataMapEncryptionVersion1  // As version 0, but the serialised map is gzipped before encryption
 };
 
 extern const EncryptionAlgorithm kSelfEncryptionVersion;
@@ -42,6 +47,26 @@ crypto::CipherText EncryptDataMap(const Identity& parent_id, const Identity& thi
 DataMap DecryptDataMap(const Identity& parent_id, const Identity& this_id,
                        const std::string& encrypted_data_map);
 
+// Batch equivalents of the above for many data maps sharing one parent, e.g. a directory listing.
+// Each element pairs this_id with its data map (or encrypted data map).  The parent's share of the
+// key derivation is done once, and the maps are processed in parallel across Concurrency() threads.
+// Results are returned in input order; the first exception thrown by any element is rethrown.
+std::vector<crypto::CipherText> EncryptDataMaps(
+    const Identity& parent_id, const std::vector<std::pair<Identity, DataMap>>& data_maps);
+
+std::vector<DataMap> DecryptDataMaps(
+    const Identity& parent_id,
+    const std::vector<std::pair<Identity, std::string>>& encrypted_data_maps);
+
+// Streaming equivalents of the above.  The data map is serialised and encrypted one chunk record at
+// a time straight into |sink| (or decrypted and parsed straight from |source|), so the memory used
+// does not grow with the number of chunks.  Since the compressed size has to be written first, the
+// map is compressed twice when streamed.  Either form can be decrypted by either DecryptDataMap.
+void EncryptDataMap(const Identity& parent_id, const Identity& this_id, const DataMap& data_map,
+                    std::ostream& sink);
+
+DataMap DecryptDataMap(const Identity& parent_id, const Identity& this_id, std::istream& source);
+
 }  // namespace encrypt
 
 }  // namespace maidsafe
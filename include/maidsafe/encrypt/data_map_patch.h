@@ -0,0 +1,68 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_DATA_MAP_PATCH_H_
+#define MAIDSAFE_ENCRYPT_DATA_MAP_PATCH_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/encrypt/data_map.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// The difference between two versions of a data map: the chunk records which were added or
+// modified, plus the new chunk count.  Small enough to replicate in place of the whole map when
+// only a few chunks of a large file have changed.
+struct DataMapPatch {
+  DataMapPatch();
+  DataMapPatch(const DataMapPatch&) = default;
+  DataMapPatch(DataMapPatch&&) MAIDSAFE_NOEXCEPT;
+  DataMapPatch& operator=(const DataMapPatch&) = default;
+  ~DataMapPatch() = default;
+
+  EncryptionAlgorithm self_encryption_version;
+  uint32_t base_num_chunks;  // Chunk count of the data map the patch applies to
+  ByteVector base_hash;      // Fingerprint of that data map
+  uint32_t num_chunks;       // Chunk count after applying the patch
+  // New records for chunks which differ from the base, in ascending index order.  Includes every
+  // chunk beyond base_num_chunks.
+  std::vector<std::pair<uint32_t, ChunkDetails>> changed_chunks;
+  // These are always small, so are carried whole.
+  ByteVector content;
+  ByteVector merkle_root;
+};
+
+// Compares every field of each chunk record, not just the hash as operator== on DataMap does.
+DataMapPatch DiffDataMaps(const DataMap& old_data_map, const DataMap& new_data_map);
+
+// Throws, leaving |data_map| unchanged, if it isn't the data map the patch was made against.
+void ApplyPatch(const DataMapPatch& patch, DataMap& data_map);
+
+void SerialiseDataMapPatch(const DataMapPatch& patch, std::string& serialised_patch);
+void ParseDataMapPatch(const std::string& serialised_patch, DataMapPatch& patch);
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_DATA_MAP_PATCH_H_
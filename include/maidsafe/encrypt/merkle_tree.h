@@ -0,0 +1,76 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_MERKLE_TREE_H_
+#define MAIDSAFE_ENCRYPT_MERKLE_TREE_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/encrypt/data_map.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// SHA512 hash tree over the ChunkDetails::hash values of a data map.  The leaves are padded to a
+// power of two, so two trees of the same width have the same shape and can be compared node by
+// node.  Its root may be kept in DataMap::merkle_root.
+class MerkleTree {
+ public:
+  explicit MerkleTree(const DataMap& data_map);
+
+  // Empty if the data map has no chunks.
+  ByteVector root() const;
+  uint32_t num_leaves() const { return num_leaves_; }
+
+  // Sibling hashes on the path from leaf |chunk_index| to the root, lowest first.  Throws if there
+  // is no such chunk.
+  std::vector<ByteVector> InclusionProof(uint32_t chunk_index) const;
+  static bool VerifyInclusionProof(const ByteVector& root, const ByteVector& chunk_hash,
+                                   uint32_t chunk_index, const std::vector<ByteVector>& proof);
+
+  friend std::vector<std::pair<uint32_t, uint32_t>> ChangedChunkRanges(const MerkleTree& lhs,
+                                                                       const MerkleTree& rhs);
+
+ private:
+  // The node covering leaves [first_leaf, first_leaf + width), where width is a power of two.
+  const byte* Node(uint32_t first_leaf, uint32_t width) const;
+  static void AddChangedRanges(const MerkleTree& lhs, const MerkleTree& rhs, uint32_t first_leaf,
+                               uint32_t width, std::vector<std::pair<uint32_t, uint32_t>>& ranges);
+
+  uint32_t num_leaves_, width_;
+  // Nodes stored as a heap of SHA512 digests: node 1 is the root, node i has children 2i and 2i+1
+  // and leaf n is node width_ + n.
+  ByteVector nodes_;
+};
+
+// Returns the [first, last) ranges of chunk indices whose hashes differ between the two trees,
+// including chunks present in only one of them.  Only subtrees which differ are visited, so this
+// costs O(changed chunks * log(chunks)) once both trees have been built.  Building a tree hashes
+// every chunk, and only its root is kept in the data map, so the saving over comparing the chunk
+// lists directly comes from keeping a tree and comparing it against several others.
+std::vector<std::pair<uint32_t, uint32_t>> ChangedChunkRanges(const MerkleTree& lhs,
+                                                              const MerkleTree& rhs);
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_MERKLE_TREE_H_
@@ -0,0 +1,57 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_SCRUBBER_H_
+#define MAIDSAFE_ENCRYPT_SCRUBBER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+struct ScrubReport {
+  ScrubReport() : chunks_checked(0), bytes_checked(0), missing_chunks(), corrupt_chunks() {}
+
+  uint64_t chunks_checked;  // Distinct chunk names fetched
+  uint64_t bytes_checked;   // Total size of the chunks retrieved
+  std::vector<ByteVector> missing_chunks;  // Names which get_from_store failed to retrieve
+  std::vector<ByteVector> corrupt_chunks;  // Names which don't match the SHA512 of their content
+};
+
+// Checks every chunk named in |data_maps| is held in the store and hashes to its name, without
+// decrypting anything.  Chunks shared between data maps are only fetched once, and at most
+// |max_concurrent_fetches| calls to |get_from_store| are made at a time.  Any exception thrown by
+// |get_from_store| marks that chunk as missing.  The reported names are sorted.
+ScrubReport ScrubDataMaps(const std::vector<DataMap>& data_maps,
+                          std::function<NonEmptyString(const std::string&)> get_from_store,
+                          int max_concurrent_fetches = Concurrency());
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_SCRUBBER_H_
@@ -0,0 +1,81 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_SELF_DECRYPTOR_H_
+#define MAIDSAFE_ENCRYPT_SELF_DECRYPTOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/encrypt/chunk_cache.h"
+#include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/self_encryptor_stats.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+class StatsCounters;
+
+// Read-only access to a self-encrypted file.  Unlike SelfEncryptor it holds no copy of the file,
+// and never changes after construction: each Read copies the chunks it covers from |cache| where
+// they're held, and fetches and decrypts the rest, several at a time.  A chunk missing from the
+// cache is fetched once however many Reads want it at the same time.  So one SelfDecryptor can
+// serve Reads from any number of threads at once, and needs no Close; the only locks taken are
+// the cache's, each held just for a lookup or insertion.  Without a cache, every Read fetches and
+// decrypts every chunk it touches.
+class SelfDecryptor {
+ public:
+  SelfDecryptor(DataMap data_map,
+                std::function<NonEmptyString(const std::string&)> get_from_store,
+                std::shared_ptr<ChunkCache> cache = nullptr);
+  ~SelfDecryptor();
+  SelfDecryptor(const SelfDecryptor&) = delete;
+  SelfDecryptor& operator=(const SelfDecryptor&) = delete;
+
+  // Returns false if the range runs past the end of the file.  Throws if a chunk can't be fetched.
+  bool Read(char* data, uint32_t length, uint64_t position) const;
+  uint64_t size() const { return kSize_; }
+  const DataMap& data_map() const { return kDataMap_; }
+  // As for SelfEncryptor; only the read-side counters move.
+  SelfEncryptorStats stats() const;
+
+ private:
+  ChunkCache::Chunk GetChunk(uint32_t chunk_number) const;
+  ByteVector DecryptChunk(uint32_t chunk_number) const;
+  uint32_t GetChunkNumber(uint64_t position) const;
+
+  const DataMap kDataMap_;
+  // Where each chunk starts in the file, followed by the file's size.
+  const std::vector<uint64_t> kChunkOffsets_;
+  const uint64_t kSize_;
+  const std::function<NonEmptyString(const std::string&)> kGetFromStore_;
+  const std::shared_ptr<ChunkCache> kCache_;
+  std::unique_ptr<StatsCounters> stats_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_SELF_DECRYPTOR_H_
@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ENCRYPT_SELF_ENCRYPTOR_H_
 #define MAIDSAFE_ENCRYPT_SELF_ENCRYPTOR_H_
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -29,20 +30,39 @@
 #include <deque>
 #include <map>
 #include <utility>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/shared_mutex.hpp"
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/data_buffer.h"
 
 #include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/self_encryptor_stats.h"
 
 namespace maidsafe {
 
 namespace encrypt {
 class Cache;
+class ChunkRangeLocks;
+template <typename Status>
+class ChunkStatusTable;
+class Sequencer;
+class StatsCounters;
+class Tracer;
 namespace test {
 class PrivateSelfEncryptorTest;
+class ChunkPipelineBenchmark;
 }
 
+// Reads and Writes may be made from any number of threads at once.  Reads of chunks already in
+// memory run in parallel, and reads which miss the same chunk at the same time share a single fetch
+// of it.  Writes run in parallel with each other and with reads of other chunks, provided they
+// neither grow the file nor come within reach of its last two chunks; other Writes, Truncate and
+// Close each run alone.
 class SelfEncryptor {
  public:
   SelfEncryptor(DataMap& data_map, DataBuffer<std::string>& buffer,
@@ -53,30 +73,77 @@ class SelfEncryptor {
   SelfEncryptor& operator=(SelfEncryptor) = delete;
 
   bool Write(const char* data, uint32_t length, uint64_t position);
+  // Takes ownership of |data|, which is left empty.  A write of exactly kMaxChunkSize bytes to a
+  // multiple of kMaxChunkSize adopts the buffer as that part of the file's storage instead of
+  // copying it; any other write copies.
+  bool Write(ByteVector&& data, uint64_t position);
   bool Read(char* data, uint32_t length, uint64_t position);
-  // Can truncate up or down
+#ifndef WIN32
+  // Scatter-gather forms: the |count| buffers are written or read back to back from |position|, as
+  // one call.  Throws CommonErrors::invalid_parameter if their total length exceeds 4 GiB.
+  bool Write(const iovec* buffers, int count, uint64_t position);
+  bool Read(const iovec* buffers, int count, uint64_t position);
+#endif
+  // Can truncate up or down.  Truncating up leaves a hole which uses no memory.
   bool Truncate(uint64_t position);
+  // A hint that the file will grow to about |expected_size| bytes.  Room is made up front for the
+  // bookkeeping of that many bytes, so appending up to it never reallocates it.  Neither the file's
+  // size nor its memory charge changes.
+  void Reserve(uint64_t expected_size);
   // Forces all buffered data to be encrypted.  Missing portions of the file are filled with '\0's
   void Close();
   bool Flush();
   uint64_t size() const { return file_size_; }
   const DataMap& data_map() const { return data_map_; }
-  const DataMap& original_data_map() const { return kOriginalDataMap_; }
+  // The data map as it was when this encryptor was opened.  It's rebuilt on each call, so is best
+  // not called often for large files.
+  DataMap original_data_map() const;
+  // Counters for this encryptor only; see also ProcessSelfEncryptorStats().
+  SelfEncryptorStats stats() const;
+  // Records spans of the chunk pipeline to |tracer|, which may be shared between encryptors.  It
+  // must outlive this encryptor, or be replaced by nullptr first.
+  void set_tracer(Tracer* tracer) { tracer_ = tracer; }
 
   friend class test::PrivateSelfEncryptorTest;
+  friend class test::ChunkPipelineBenchmark;
 
  private:
-  // read in all data and up to next 2 chunks
-  void PrepareWindow(uint32_t length, uint64_t position, bool write);
+  // read in all data and up to next 2 chunks, ready to be written.  If |overwrite|, the caller is
+  // about to replace [position, position + length) so remote chunks wholly inside it aren't
+  // fetched.  Needs either mutex_ held exclusively, or mutex_ held shared with the chunks of
+  // GetWindow(length, position) locked in range_locks_, the range not running past the end of the
+  // file, and the window clear of its last two chunks.
+  void PrepareWindow(uint64_t length, uint64_t position, bool overwrite = false);
+  // As PrepareWindow, but only brings in remote chunks, under the shared |lock| on mutex_, which is
+  // released while the fetched chunks are stored.  Returns false if the range can no longer be
+  // read, or a chunk it covers couldn't be fetched.
+  bool PrepareReadWindow(uint64_t length, uint64_t position,
+                         boost::shared_lock<boost::shared_mutex>& lock);
+  // Grows the file to |size|, leaving a hole whose chunks are encrypted on Close.
+  void ExtendTo(uint64_t size);
+  // The chunks at the end of the file change shape when its size does, so any of them still remote
+  // must be read in at their current positions before the size changes to |size|.
+  void PrepareResize(uint64_t size);
+  // The chunks PrepareWindow(length, position) changes, once the file has at least 3 full chunks:
+  // those the range touches and the two after them, as [first, last).
+  std::pair<uint32_t, uint32_t> GetWindow(uint64_t length, uint64_t position) const;
+  // Runs a Write of [position, position + length), with |copy_in| storing the data.  Runs in
+  // parallel with other Writes where possible.
+  template <typename CopyIn>
+  bool WriteRange(uint32_t length, uint64_t position, CopyIn copy_in);
   // Retrieves the encrypted chunk from chunk_store_ and decrypts it to "data".
   ByteVector DecryptChunk(uint32_t chunk_num);
   // Retrieves appropriate pre-hashes from data_map_ and constructs key, IV and
   // encryption pad.
   void GetPadIvKey(uint32_t this_chunk_num, ByteVector& key, ByteVector& iv, ByteVector& pad);
-  // Encrypts the chunk and stores in chunk_store_
-  void EncryptChunk(uint32_t chunk_num, ByteVector data, uint32_t length);
+  // Encrypts the |length| bytes at |data| as chunk |chunk_num| and stores in chunk_store_
+  void EncryptChunk(uint32_t chunk_num, const byte* data, uint32_t length);
+  // Brings the memory charged for sequencer_ into line with its allocated segments.
+  void ChargeSequencer();
+  // Saves chunk |chunk_num| of data_map_ to journal_ before it's first changed.
+  void JournalChunk(uint32_t chunk_num);
   void CleanUpAfterException() {
-    std::swap(data_map_, kOriginalDataMap_);
+    journal_.Restore(data_map_);
     assert(false && "cleaned up after exception");
   }
   // ###############################################################################
@@ -90,21 +157,43 @@ class SelfEncryptor {
   uint32_t GetChunkNumber(uint64_t position) const;
   // ########end of helpers#########################################################
 
-  enum class ChunkStatus {
+  enum class ChunkStatus : uint8_t {
     to_be_hashed,
     to_be_encrypted,
     stored,  // therefor only being used as read cache`
-    remote
+    remote,
+    fetching,  // remote, and being fetched by a reader
+    none  // not yet seen by this encryptor
   };
 
-  DataMap& data_map_, kOriginalDataMap_;
-  std::vector<byte> sequencer_;
-  std::map<uint32_t, ChunkStatus> chunks_;
+  // Undo journal for data_map_.  Rather than a full copy, only the chunk entries changed since it
+  // was opened are kept, along with the rest of the data map as opened.
+  struct DataMapJournal {
+    explicit DataMapJournal(const DataMap& data_map);
+    void Restore(DataMap& data_map) const;
+
+    EncryptionAlgorithm self_encryption_version;
+    size_t chunk_count;
+    ByteVector content, merkle_root;
+    std::map<uint32_t, ChunkDetails> chunks;
+  };
+
+  DataMap& data_map_;
+  DataMapJournal journal_;
+  std::unique_ptr<Sequencer> sequencer_;
+  std::unique_ptr<ChunkStatusTable<ChunkStatus>> chunks_;
   DataBuffer<std::string>& buffer_;
   std::function<NonEmptyString(const std::string&)> get_from_store_;
   uint64_t file_size_;
   bool closed_;
+  mutable boost::shared_mutex mutex_;
+  boost::condition_variable_any fetched_;  // notified once a reader's fetched chunks are stored
+  std::unique_ptr<ChunkRangeLocks> range_locks_;  // For Reads and Writes sharing mutex_
   mutable std::mutex data_mutex_;
+  std::unique_ptr<StatsCounters> stats_;
+  std::mutex charge_mutex_;  // Guards sequencer_charge_
+  uint64_t sequencer_charge_;
+  Tracer* tracer_;
 };
 
 }  // namespace encrypt
@@ -0,0 +1,92 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_SELF_ENCRYPTOR_STATS_H_
+#define MAIDSAFE_ENCRYPT_SELF_ENCRYPTOR_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Snapshot of the work done by one SelfEncryptor, or by all of them in the process.  Times are
+// summed across threads, so can exceed the wall-clock time when chunks are processed in parallel.
+struct SelfEncryptorStats {
+  SelfEncryptorStats()
+      : bytes_written(0),
+        bytes_read(0),
+        chunks_fetched(0),
+        chunks_decrypted(0),
+        chunks_encrypted(0),
+        chunks_stored(0),
+        cache_hits(0),
+        fetches_skipped(0),
+        zero_chunks_reused(0),
+        fetch_time(0),
+        decrypt_time(0),
+        hash_time(0),
+        encrypt_time(0),
+        store_time(0),
+        peak_sequencer_bytes(0),
+        memory_bytes(0),
+        peak_memory_bytes(0) {}
+
+  uint64_t bytes_written;
+  uint64_t bytes_read;
+  uint64_t chunks_fetched;    // From get_from_store
+  uint64_t chunks_decrypted;
+  uint64_t chunks_encrypted;
+  uint64_t chunks_stored;     // To the DataBuffer
+  uint64_t cache_hits;        // Chunks needed by a Read or Write which were already in memory
+  uint64_t fetches_skipped;   // Remote chunks not fetched since a Write replaced all of them
+  // All-zero chunks given the name of an identical one rather than being encrypted again
+  uint64_t zero_chunks_reused;
+  std::chrono::nanoseconds fetch_time;
+  std::chrono::nanoseconds decrypt_time;  // Decrypting, un-XORing and decompressing
+  std::chrono::nanoseconds hash_time;     // Pre-hashes and chunk names
+  std::chrono::nanoseconds encrypt_time;  // Compressing, encrypting and XORing
+  std::chrono::nanoseconds store_time;
+  // Most memory held for a file's contents, which excludes holes in sparse files; process-wide this
+  // is the most held by any encryptor.
+  uint64_t peak_sequencer_bytes;
+  // Bytes currently held in the file buffer and in chunk-sized temporaries, and the high-water mark
+  // of that.  Process-wide, these are summed over all live encryptors.  Chunks held by the
+  // DataBuffer are bounded by its own limits, so aren't included.
+  uint64_t memory_bytes;
+  uint64_t peak_memory_bytes;
+};
+
+// Totals for every SelfEncryptor in the process since startup or the last reset.  A reset leaves
+// memory_bytes alone and restarts peak_memory_bytes from it.
+SelfEncryptorStats ProcessSelfEncryptorStats();
+void ResetProcessSelfEncryptorStats();
+
+// Flattens |stats| into name/value pairs (times in nanoseconds), e.g. for export to a metrics
+// system.
+std::vector<std::pair<std::string, uint64_t>> ToNamedValues(const SelfEncryptorStats& stats);
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_SELF_ENCRYPTOR_STATS_H_
@@ -0,0 +1,101 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_TRACER_H_
+#define MAIDSAFE_ENCRYPT_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Buffer of up to |capacity| timed spans from the chunk pipeline, written out in the Chrome
+// trace-event format for viewing in chrome://tracing or Perfetto.  The buffer grows a block at a
+// time as spans are recorded, so a large capacity costs nothing until it's used.  Recording is
+// lock-free and may be done from any number of threads; once the buffer is full further spans are
+// counted but dropped.
+class Tracer {
+ public:
+  typedef std::chrono::steady_clock clock;
+  static const uint32_t kNoChunk = std::numeric_limits<uint32_t>::max();
+
+  explicit Tracer(size_t capacity = 1 << 20);
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+  ~Tracer();
+
+  // |name| must be a string literal or otherwise outlive the tracer.
+  void Record(const char* name, uint32_t chunk, clock::time_point start, clock::time_point end);
+  // Spans still being recorded while this runs are omitted.
+  void WriteChromeTrace(std::ostream& output) const;
+  size_t size() const;
+  size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Span {
+    Span() : name(nullptr), chunk(kNoChunk), thread(0), start(), end(), complete(false) {}
+    const char* name;
+    uint32_t chunk;
+    uint32_t thread;
+    clock::time_point start, end;
+    std::atomic<bool> complete;
+  };
+  static const size_t kBlockSize = 4096;
+
+  // Allocates the span's block if no other thread has yet.
+  Span& SpanToRecord(size_t index);
+
+  const size_t kCapacity_;
+  const clock::time_point kOrigin_;
+  std::unique_ptr<std::atomic<Span*>[]> blocks_;
+  std::atomic<size_t> next_span_, dropped_;
+};
+
+// Records a span from construction to destruction if |tracer| is non-null.
+class TraceSpan {
+ public:
+  TraceSpan(Tracer* tracer, const char* name, uint32_t chunk = Tracer::kNoChunk)
+      : tracer_(tracer),
+        kName_(name),
+        kChunk_(chunk),
+        kStart_(tracer ? Tracer::clock::now() : Tracer::clock::time_point()) {}
+  ~TraceSpan() {
+    if (tracer_)
+      tracer_->Record(kName_, kChunk_, kStart_, Tracer::clock::now());
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  Tracer* const tracer_;
+  const char* const kName_;
+  const uint32_t kChunk_;
+  const Tracer::clock::time_point kStart_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_TRACER_H_
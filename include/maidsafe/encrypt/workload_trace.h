@@ -0,0 +1,93 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_WORKLOAD_TRACE_H_
+#define MAIDSAFE_ENCRYPT_WORKLOAD_TRACE_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "maidsafe/encrypt/self_encryptor.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// One call made on a SelfEncryptor.  Only offsets and sizes are kept, never the data itself.
+struct WorkloadOperation {
+  enum Type : uint8_t { kWrite, kRead, kTruncate, kFlush, kClose, kTypeCount };
+
+  WorkloadOperation() : type(kFlush), position(0), length(0) {}
+  WorkloadOperation(Type type_in, uint64_t position_in, uint32_t length_in)
+      : type(type_in), position(position_in), length(length_in) {}
+
+  Type type;
+  uint64_t position;  // The new size for kTruncate
+  uint32_t length;
+};
+
+bool operator==(const WorkloadOperation& lhs, const WorkloadOperation& rhs);
+
+// Binary trace format: a "MSWT" magic and a version byte, then per operation a type byte followed
+// by (for Write, Read and Truncate) the position as a zigzag varint delta from the end of the
+// previous operation and (for Write and Read) the length as a varint.  Sequential I/O therefore
+// costs two or three bytes per operation.
+void WriteWorkloadTrace(const std::vector<WorkloadOperation>& operations, std::ostream& sink);
+// Throws CommonErrors::parsing_error if |source| isn't a complete, valid trace.
+std::vector<WorkloadOperation> ReadWorkloadTrace(std::istream& source);
+
+// Forwards calls to a SelfEncryptor, recording each one.
+class WorkloadRecorder {
+ public:
+  explicit WorkloadRecorder(SelfEncryptor& self_encryptor)
+      : self_encryptor_(self_encryptor), operations_() {}
+  WorkloadRecorder(const WorkloadRecorder&) = delete;
+  WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+  bool Write(const char* data, uint32_t length, uint64_t position);
+  bool Read(char* data, uint32_t length, uint64_t position);
+  bool Truncate(uint64_t position);
+  bool Flush();
+  void Close();
+
+  const std::vector<WorkloadOperation>& operations() const { return operations_; }
+
+ private:
+  SelfEncryptor& self_encryptor_;
+  std::vector<WorkloadOperation> operations_;
+};
+
+// Latency of every replayed call, by operation type.
+typedef std::array<std::vector<std::chrono::steady_clock::duration>,
+                   WorkloadOperation::kTypeCount> WorkloadLatencies;
+
+// Runs |operations| against |self_encryptor|, writing generated data.  A Read past the end of the
+// file returns false as it did when recorded, so isn't treated as an error.  Stops after a kClose
+// operation, since the encryptor can't be used after that.
+WorkloadLatencies ReplayWorkload(const std::vector<WorkloadOperation>& operations,
+                                 SelfEncryptor& self_encryptor);
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_WORKLOAD_TRACE_H_
@@ -0,0 +1,118 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/chunk_cache.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+ChunkCache::ChunkCache(uint64_t capacity) : kCapacity_(capacity), shards_() {}
+
+ChunkCache::Chunk ChunkCache::Get(const ByteVector& name) {
+  Shard& shard(ShardFor(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return Find(shard, name);
+}
+
+void ChunkCache::Put(const ByteVector& name, Chunk chunk) {
+  Shard& shard(ShardFor(name));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Insert(shard, name, std::move(chunk));
+}
+
+ChunkCache::Chunk ChunkCache::GetOrLoad(const ByteVector& name,
+                                        const std::function<Chunk()>& load) {
+  Shard& shard(ShardFor(name));
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  Chunk chunk(Find(shard, name));
+  if (chunk)
+    return chunk;
+  auto itr(shard.loading.find(name));
+  if (itr != std::end(shard.loading)) {  // Another reader is already loading it.
+    std::shared_future<Chunk> pending(itr->second);
+    lock.unlock();
+    return pending.get();
+  }
+  std::promise<Chunk> loaded;
+  shard.loading.insert(std::make_pair(name, loaded.get_future().share()));
+  lock.unlock();
+
+  // The load is done without the lock, so other chunks in the shard can be got meanwhile.
+  try {
+    chunk = load();
+  }
+  catch (...) {
+    lock.lock();
+    shard.loading.erase(name);
+    loaded.set_exception(std::current_exception());
+    throw;
+  }
+  lock.lock();
+  Insert(shard, name, chunk);
+  shard.loading.erase(name);
+  lock.unlock();
+  loaded.set_value(chunk);
+  return chunk;
+}
+
+uint64_t ChunkCache::size() const {
+  uint64_t size(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    size += shard.size;
+  }
+  return size;
+}
+
+ChunkCache::Shard& ChunkCache::ShardFor(const ByteVector& name) {
+  // Names are hashes, so any byte of them spreads chunks evenly.
+  return shards_[name.empty() ? 0 : name.back() % kShardCount];
+}
+
+ChunkCache::Chunk ChunkCache::Find(Shard& shard, const ByteVector& name) {
+  auto itr(shard.index.find(name));
+  if (itr == std::end(shard.index))
+    return nullptr;
+  shard.entries.splice(std::begin(shard.entries), shard.entries, itr->second);
+  return itr->second->second;
+}
+
+void ChunkCache::Insert(Shard& shard, const ByteVector& name, Chunk chunk) {
+  const uint64_t kShardCapacity(kCapacity_ / kShardCount);
+  if (!chunk || chunk->size() > kShardCapacity)
+    return;
+  auto itr(shard.index.find(name));
+  if (itr != std::end(shard.index)) {  // Another reader got here first.
+    shard.entries.splice(std::begin(shard.entries), shard.entries, itr->second);
+    return;
+  }
+  shard.size += chunk->size();
+  shard.entries.emplace_front(name, std::move(chunk));
+  shard.index.insert(std::make_pair(name, std::begin(shard.entries)));
+  while (shard.size > kShardCapacity) {
+    const auto& oldest(shard.entries.back());
+    shard.size -= oldest.second->size();
+    shard.index.erase(oldest.first);
+    shard.entries.pop_back();
+  }
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
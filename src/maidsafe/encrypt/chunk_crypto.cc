@@ -0,0 +1,89 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/chunk_crypto.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#ifdef __MSVC__
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/aes.h"
+#include "cryptopp/gzip.h"
+#include "cryptopp/modes.h"
+#include "cryptopp/mqueue.h"
+#ifdef __MSVC__
+#pragma warning(pop)
+#endif
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/encrypt/xor.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+void GetPadIvKey(const ByteVector& pre_hash, const ByteVector& n_1_pre_hash,
+                 const ByteVector& n_2_pre_hash, ByteVector& key, ByteVector& iv, ByteVector& pad) {
+  assert(pre_hash.size() == crypto::SHA512::DIGESTSIZE);
+  assert(n_1_pre_hash.size() == crypto::SHA512::DIGESTSIZE);
+  assert(n_2_pre_hash.size() == crypto::SHA512::DIGESTSIZE);
+  key.clear();
+  // cannot use copy_n as there is an apparent bug in MSVC 2013 :-(
+  std::copy(std::begin(n_2_pre_hash), std::begin(n_2_pre_hash) + crypto::AES256_KeySize,
+            std::back_inserter(key));
+  iv.clear();
+  std::copy(std::begin(n_2_pre_hash) + crypto::AES256_KeySize,
+            std::begin(n_2_pre_hash) + crypto::AES256_KeySize + crypto::AES256_IVSize,
+            std::back_inserter(iv));
+  // pad
+  assert(kPadSize == (2 * crypto::SHA512::DIGESTSIZE) + crypto::SHA512::DIGESTSIZE -
+                         crypto::AES256_KeySize - crypto::AES256_IVSize &&
+         "pad size wrong");
+  pad.clear();
+  std::copy_n(std::begin(n_1_pre_hash), crypto::SHA512::DIGESTSIZE, std::back_inserter(pad));
+  std::copy_n(std::begin(pre_hash), crypto::SHA512::DIGESTSIZE, std::back_inserter(pad));
+  std::copy_n(std::begin(n_2_pre_hash) + crypto::AES256_KeySize + crypto::AES256_IVSize,
+              crypto::SHA512::DIGESTSIZE - crypto::AES256_KeySize - crypto::AES256_IVSize,
+              std::back_inserter(pad));
+  assert(pad.size() == kPadSize && "pad size incorrect");
+  assert(key.size() == crypto::AES256_KeySize && "key size incorrect");
+  assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
+}
+
+void DecryptChunkContent(const std::string& content, const ByteVector& key, const ByteVector& iv,
+                         const ByteVector& pad, byte* data, uint32_t length) {
+  assert(pad.size() == kPadSize && "pad size incorrect");
+  assert(key.size() == crypto::AES256_KeySize && "key size incorrect");
+  assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
+  CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption decryptor(&key.data()[0], crypto::AES256_KeySize,
+                                                          &iv.data()[0]);
+  CryptoPP::StringSource filter(
+      content, true,
+      new XORFilter(new CryptoPP::StreamTransformationFilter(
+                        decryptor, new CryptoPP::Gunzip(new CryptoPP::MessageQueue)),
+                    &pad.data()[0]));
+  filter.Get(data, length);
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,45 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_CHUNK_CRYPTO_H_
+#define MAIDSAFE_ENCRYPT_CHUNK_CRYPTO_H_
+
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/encrypt/config.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Builds the key, IV and XOR pad which chunk n is encrypted with, from its own |pre_hash| and
+// those of chunks n-1 and n-2.
+void GetPadIvKey(const ByteVector& pre_hash, const ByteVector& n_1_pre_hash,
+                 const ByteVector& n_2_pre_hash, ByteVector& key, ByteVector& iv, ByteVector& pad);
+
+// Reverses the gzip, AES-256-CFB and XOR stages a chunk is stored through, decrypting its stored
+// |content| to the |length| bytes at |data|.
+void DecryptChunkContent(const std::string& content, const ByteVector& key, const ByteVector& iv,
+                         const ByteVector& pad, byte* data, uint32_t length);
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_CHUNK_CRYPTO_H_
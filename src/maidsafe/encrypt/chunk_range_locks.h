@@ -0,0 +1,102 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_CHUNK_RANGE_LOCKS_H_
+#define MAIDSAFE_ENCRYPT_CHUNK_RANGE_LOCKS_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Shared and exclusive locks on ranges of chunks [first, last), so that operations on different
+// parts of a file can run at once.  A range is locked whole or not at all, but a thread holding one
+// range and waiting for another can still deadlock, so each thread should hold at most one.
+class ChunkRangeLocks {
+ public:
+  // Holds a range locked for as long as it's in scope.
+  class Guard {
+   public:
+    Guard(ChunkRangeLocks& locks, uint32_t first, uint32_t last, bool exclusive)
+        : locks_(locks), kFirst_(first), kLast_(last), kExclusive_(exclusive) {
+      locks_.Lock(kFirst_, kLast_, kExclusive_);
+    }
+    ~Guard() { locks_.Unlock(kFirst_, kLast_, kExclusive_); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    ChunkRangeLocks& locks_;
+    const uint32_t kFirst_, kLast_;
+    const bool kExclusive_;
+  };
+
+  ChunkRangeLocks() : mutex_(), released_(), held_() {}
+  ChunkRangeLocks(const ChunkRangeLocks&) = delete;
+  ChunkRangeLocks& operator=(const ChunkRangeLocks&) = delete;
+
+  // Blocks until no overlapping range is held exclusively, or if |exclusive|, held at all.  Empty
+  // ranges never wait.
+  void Lock(uint32_t first, uint32_t last, bool exclusive) {
+    if (first >= last)
+      return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&] {
+      return std::none_of(std::begin(held_), std::end(held_), [&](const Range& range) {
+        return range.first < last && first < range.last && (exclusive || range.exclusive);
+      });
+    });
+    held_.push_back(Range(first, last, exclusive));
+  }
+  void Unlock(uint32_t first, uint32_t last, bool exclusive) {
+    if (first >= last)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto itr(std::find_if(std::begin(held_), std::end(held_), [&](const Range& range) {
+        return range.first == first && range.last == last && range.exclusive == exclusive;
+      }));
+      if (itr != std::end(held_))
+        held_.erase(itr);
+    }
+    released_.notify_all();
+  }
+
+ private:
+  struct Range {
+    Range(uint32_t first_in, uint32_t last_in, bool exclusive_in)
+        : first(first_in), last(last_in), exclusive(exclusive_in) {}
+    uint32_t first, last;
+    bool exclusive;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable released_;
+  std::vector<Range> held_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_CHUNK_RANGE_LOCKS_H_
@@ -0,0 +1,95 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_CHUNK_STATUS_TABLE_H_
+#define MAIDSAFE_ENCRYPT_CHUNK_STATUS_TABLE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Dense table of one status per chunk.  Each status is atomic, so worker threads can update their
+// own chunks' statuses without a lock while the table stays the same size.  Anything which changes
+// the size must not run concurrently with other calls.
+template <typename Status>
+class ChunkStatusTable {
+ public:
+  // Chunks never set, or dropped by Resize, read as |absent|.
+  explicit ChunkStatusTable(Status absent)
+      : kAbsent_(absent), statuses_(), size_(0), capacity_(0) {}
+  ChunkStatusTable(const ChunkStatusTable&) = delete;
+  ChunkStatusTable& operator=(const ChunkStatusTable&) = delete;
+
+  uint32_t size() const { return size_; }
+  Status absent() const { return kAbsent_; }
+
+  Status Get(uint32_t chunk) const {
+    return chunk < size_ ? statuses_[chunk].load(std::memory_order_acquire) : kAbsent_;
+  }
+  // Grows the table to hold |chunk| if needed.
+  void Set(uint32_t chunk, Status status) {
+    if (chunk >= size_)
+      Resize(chunk + 1);
+    statuses_[chunk].store(status, std::memory_order_release);
+  }
+  // Sets |chunk| to |desired| only if it's currently |expected|, otherwise loads its status into
+  // |expected|.  Never grows the table, so can run alongside Get and Set on other threads.
+  bool CompareExchange(uint32_t chunk, Status& expected, Status desired) {
+    if (chunk >= size_) {
+      expected = kAbsent_;
+      return false;
+    }
+    return statuses_[chunk].compare_exchange_strong(expected, desired, std::memory_order_acq_rel);
+  }
+  // Shrinking drops the statuses past |size|; growing adds absent ones.  Capacity is doubled as
+  // needed, so growing one chunk at a time is amortised constant time.
+  void Resize(uint32_t size) {
+    if (size > capacity_)
+      Reserve(std::max(size, 2 * capacity_));
+    for (uint32_t i(size_); i < size; ++i)
+      statuses_[i].store(kAbsent_, std::memory_order_relaxed);
+    size_ = size;
+  }
+  void Clear() { Resize(0); }
+  // Makes room for |capacity| statuses without changing the size.
+  void Reserve(uint32_t capacity) {
+    if (capacity <= capacity_)
+      return;
+    std::unique_ptr<std::atomic<Status>[]> statuses(new std::atomic<Status>[capacity]);
+    for (uint32_t i(0); i != size_; ++i)
+      statuses[i].store(statuses_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    statuses_.swap(statuses);
+    capacity_ = capacity;
+  }
+
+ private:
+  const Status kAbsent_;
+  std::unique_ptr<std::atomic<Status>[]> statuses_;
+  uint32_t size_, capacity_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_CHUNK_STATUS_TABLE_H_
@@ -36,12 +36,14 @@ ChunkDetails::ChunkDetails(ChunkDetails&& other) MAIDSAFE_NOEXCEPT
       storage_state(std::move(other.storage_state)),
       size(std::move(other.size)) {}
 
-DataMap::DataMap() : self_encryption_version(kSelfEncryptionVersion), chunks(), content() {}
+DataMap::DataMap()
+    : self_encryption_version(kSelfEncryptionVersion), chunks(), content(), merkle_root() {}
 
 DataMap::DataMap(DataMap&& other) MAIDSAFE_NOEXCEPT
     : self_encryption_version(std::move(other.self_encryption_version)),
       chunks(std::move(other.chunks)),
-      content(std::move(other.content)) {}
+      content(std::move(other.content)),
+      merkle_root(std::move(other.merkle_root)) {}
 
 uint64_t DataMap::size() const {
   return chunks.empty()
@@ -86,6 +88,10 @@ void SerialiseDataMap(const DataMap& data_map, std::string& serialised_data_map)
       chunk_details->set_storage_state(chunk_detail.storage_state);
     }
   }
+  if (!data_map.merkle_root.empty()) {
+    proto_data_map.set_merkle_root(
+        std::string(std::begin(data_map.merkle_root), std::end(data_map.merkle_root)));
+  }
   if (!proto_data_map.SerializeToString(&serialised_data_map))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
 }
@@ -122,6 +128,10 @@ void ParseDataMap(const std::string& serialised_data_map, DataMap& data_map) {
   } else if (proto_data_map.chunk_details_size() != 0) {
     ExtractChunkDetails(proto_data_map, data_map);
   }
+  if (proto_data_map.has_merkle_root()) {
+    data_map.merkle_root = ByteVector(std::begin(proto_data_map.merkle_root()),
+                                      std::end(proto_data_map.merkle_root()));
+  }
 }
 
 }  // namespace encrypt
@@ -20,16 +20,22 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <array>
+#include <future>
+#include <iterator>
 #include <limits>
 #include <set>
+#include <string>
 #include <tuple>
 #include <utility>
 #include <memory>
+#include <vector>
 
 #ifdef __MSVC__
 #pragma warning(push, 1)
 #endif
 #include "cryptopp/aes.h"
+#include "cryptopp/files.h"
 #include "cryptopp/gzip.h"
 #include "cryptopp/modes.h"
 #include "cryptopp/mqueue.h"
@@ -39,6 +45,9 @@
 #endif
 
 #include "boost/exception/all.hpp"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/wire_format_lite.h"
 #include "maidsafe/common/config.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
@@ -58,30 +67,248 @@ namespace encrypt {
 
 const EncryptionAlgorithm kSelfEncryptionVersion = EncryptionAlgorithm::kSelfEncryptionVersion0;
 const EncryptionAlgorithm kDataMapEncryptionVersion =
-    EncryptionAlgorithm::kDataMapEncryptionVersion0;
+    EncryptionAlgorithm::kDataMapEncryptionVersion1;
 
 namespace {
 
-DataMap DecryptUsingVersion0(const Identity& parent_id, const Identity& this_id,
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+const size_t kStreamBufferSize(64 * 1024);
+const unsigned int kDataMapCompressionLevel(6);
+
+// Wire tags of the fields in data_map.proto.  The version tag is shared by protobuf::DataMap and
+// protobuf::EncryptedDataMap, and chunk_details shares its tag with EncryptedDataMap::contents.
+const uint32_t kVersionTag(WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_VARINT));
+const uint32_t kContentsTag(WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+const uint32_t kChunkDetailsTag(kContentsTag);
+const uint32_t kContentTag(WireFormatLite::MakeTag(3, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+const uint32_t kMerkleRootTag(
+    WireFormatLite::MakeTag(4, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+const uint32_t kHashTag(WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+const uint32_t kPreHashTag(WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+const uint32_t kSizeTag(WireFormatLite::MakeTag(3, WireFormatLite::WIRETYPE_VARINT));
+const uint32_t kStorageStateTag(WireFormatLite::MakeTag(5, WireFormatLite::WIRETYPE_VARINT));
+
+// The AES key and IV are taken from enc_hash (SHA512 of parent_id + this_id) and the XOR pad is
+// xor_hash (SHA512 of this_id + parent_id).
+struct DataMapKeys {
+  std::array<byte, crypto::SHA512::DIGESTSIZE> enc_hash;
+  std::array<byte, crypto::SHA512::DIGESTSIZE> xor_hash;
+};
+
+void HashUpdate(CryptoPP::SHA512& hash, const Identity& id) {
+  hash.Update(reinterpret_cast<const byte*>(id.string().data()), id.string().size());
+}
+
+// |parent_hash| must already have been updated with parent_id, so a batch sharing a parent only
+// hashes that once.  The ids are hashed in place rather than concatenated, so nothing is allocated.
+void GetDataMapKeys(const CryptoPP::SHA512& parent_hash, const Identity& parent_id,
+                    const Identity& this_id, DataMapKeys& keys) {
+  CryptoPP::SHA512 enc_hash(parent_hash);
+  HashUpdate(enc_hash, this_id);
+  enc_hash.Final(keys.enc_hash.data());
+  CryptoPP::SHA512 xor_hash;
+  HashUpdate(xor_hash, this_id);
+  HashUpdate(xor_hash, parent_id);
+  xor_hash.Final(keys.xor_hash.data());
+}
+
+void GetDataMapKeys(const Identity& parent_id, const Identity& this_id, DataMapKeys& keys) {
+  CryptoPP::SHA512 parent_hash;
+  HashUpdate(parent_hash, parent_id);
+  GetDataMapKeys(parent_hash, parent_id, this_id, keys);
+}
+
+uint64_t LengthDelimitedSize(uint64_t length) {
+  return 1 + CodedOutputStream::VarintSize64(length) + length;
+}
+
+// Size of a serialised protobuf::ChunkDetails, excluding its own tag and length.
+uint64_t ChunkDetailsSize(const ChunkDetails& chunk) {
+  return LengthDelimitedSize(chunk.hash.size()) + LengthDelimitedSize(chunk.pre_hash.size()) + 1 +
+         CodedOutputStream::VarintSize32(chunk.size) + 1 +
+         CodedOutputStream::VarintSize32(static_cast<uint32_t>(chunk.storage_state));
+}
+
+void WriteBytes(uint32_t tag, const ByteVector& bytes, CodedOutputStream& output) {
+  output.WriteTag(tag);
+  output.WriteVarint32(static_cast<uint32_t>(bytes.size()));
+  if (!bytes.empty())
+    output.WriteRaw(&bytes.data()[0], static_cast<int>(bytes.size()));
+}
+
+// Writes the same wire format as SerialiseDataMap, one chunk record at a time.
+void WriteDataMap(const DataMap& data_map, CodedOutputStream& output) {
+  output.WriteTag(kVersionTag);
+  output.WriteVarint32(static_cast<uint32_t>(data_map.self_encryption_version));
+  if (!data_map.content.empty()) {
+    WriteBytes(kContentTag, data_map.content, output);
+  } else {
+    for (const auto& chunk : data_map.chunks) {
+      output.WriteTag(kChunkDetailsTag);
+      output.WriteVarint32(static_cast<uint32_t>(ChunkDetailsSize(chunk)));
+      WriteBytes(kHashTag, chunk.hash, output);
+      WriteBytes(kPreHashTag, chunk.pre_hash, output);
+      output.WriteTag(kSizeTag);
+      output.WriteVarint32(chunk.size);
+      output.WriteTag(kStorageStateTag);
+      output.WriteVarint32(static_cast<uint32_t>(chunk.storage_state));
+    }
+  }
+  if (!data_map.merkle_root.empty())
+    WriteBytes(kMerkleRootTag, data_map.merkle_root, output);
+}
+
+// Reads the rest of a protobuf::DataMap from |input|, one record per CodedInputStream so that
+// protobuf's total bytes limit never applies to the whole map.
+DataMap ReadDataMap(google::protobuf::io::ZeroCopyInputStream& input) {
+  DataMap data_map;
+  bool has_version(false);
+  for (;;) {
+    CodedInputStream coded_input(&input);
+    uint32_t tag(coded_input.ReadTag());
+    if (tag == 0)
+      break;
+    uint32_t value(0);
+    if (tag == kVersionTag) {
+      if (!coded_input.ReadVarint32(&value))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      data_map.self_encryption_version = static_cast<EncryptionAlgorithm>(value);
+      has_version = true;
+    } else if (tag == kChunkDetailsTag) {
+      if (!coded_input.ReadVarint32(&value))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      auto limit(coded_input.PushLimit(static_cast<int>(value)));
+      protobuf::ChunkDetails proto_chunk;
+      if (!proto_chunk.ParseFromCodedStream(&coded_input) || !coded_input.ConsumedEntireMessage())
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      coded_input.PopLimit(limit);
+      ChunkDetails chunk;
+      chunk.hash.assign(std::begin(proto_chunk.hash()), std::end(proto_chunk.hash()));
+      chunk.pre_hash.assign(std::begin(proto_chunk.pre_hash()), std::end(proto_chunk.pre_hash()));
+      chunk.size = proto_chunk.size();
+      chunk.storage_state = static_cast<ChunkDetails::StorageState>(proto_chunk.storage_state());
+      data_map.chunks.push_back(std::move(chunk));
+    } else if (tag == kContentTag) {
+      std::string content;
+      if (!coded_input.ReadVarint32(&value) ||
+          !coded_input.ReadString(&content, static_cast<int>(value))) {
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      }
+      data_map.content.assign(std::begin(content), std::end(content));
+    } else if (tag == kMerkleRootTag) {
+      std::string merkle_root;
+      if (!coded_input.ReadVarint32(&value) ||
+          !coded_input.ReadString(&merkle_root, static_cast<int>(value))) {
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      }
+      data_map.merkle_root.assign(std::begin(merkle_root), std::end(merkle_root));
+    } else if (!WireFormatLite::SkipField(&coded_input, tag)) {
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  if (!has_version)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return data_map;
+}
+
+// Puts everything written to it into |filter|, e.g. a compression and encryption chain.
+class FilterOutputStream : public google::protobuf::io::CopyingOutputStream {
+ public:
+  explicit FilterOutputStream(CryptoPP::BufferedTransformation& filter) : filter_(filter) {}
+
+  bool Write(const void* buffer, int size) override {
+    filter_.Put(static_cast<const byte*>(buffer), size);
+    return true;
+  }
+
+ private:
+  CryptoPP::BufferedTransformation& filter_;
+};
+
+// Serialises |data_map| through |filter| in kStreamBufferSize pieces, then ends the message.
+bool WriteDataMap(const DataMap& data_map, CryptoPP::BufferedTransformation& filter) {
+  FilterOutputStream filter_stream(filter);
+  google::protobuf::io::CopyingOutputStreamAdaptor adaptor(&filter_stream,
+                                                           static_cast<int>(kStreamBufferSize));
+  bool failed(false);
+  {
+    CodedOutputStream output(&adaptor);
+    WriteDataMap(data_map, output);
+    failed = output.HadError();
+  }
+  if (failed || !adaptor.Flush())
+    return false;
+  filter.MessageEnd();
+  return true;
+}
+
+// Puts |length| bytes read from |source| into |filter| as they are needed, and hands out whatever
+// arrives in |output|, the MessageQueue at the end of |filter|'s chain.
+class FilterInputStream : public google::protobuf::io::CopyingInputStream {
+ public:
+  FilterInputStream(std::istream& source, uint64_t length, CryptoPP::BufferedTransformation& filter,
+                    CryptoPP::BufferedTransformation& output)
+      : source_(source),
+        remaining_(length),
+        filter_(filter),
+        output_(output),
+        buffer_(kStreamBufferSize),
+        finished_(false) {}
+
+  bool AllRead() const { return finished_; }
+
+  int Read(void* buffer, int size) override {
+    while (!output_.AnyRetrievable() && !finished_) {
+      if (remaining_ == 0) {
+        filter_.MessageEnd();
+        finished_ = true;
+        break;
+      }
+      auto to_read(static_cast<std::streamsize>(std::min<uint64_t>(buffer_.size(), remaining_)));
+      source_.read(reinterpret_cast<char*>(&buffer_.data()[0]), to_read);
+      auto got(static_cast<size_t>(source_.gcount()));
+      if (got == 0)
+        return -1;  // truncated
+      remaining_ -= got;
+      filter_.Put(&buffer_.data()[0], got);
+    }
+    return static_cast<int>(output_.Get(static_cast<byte*>(buffer), size));
+  }
+
+ private:
+  std::istream& source_;
+  uint64_t remaining_;
+  CryptoPP::BufferedTransformation& filter_;
+  CryptoPP::BufferedTransformation& output_;
+  ByteVector buffer_;
+  bool finished_;
+};
+
+bool ReadVarint(std::istream& source, uint64_t& value) {
+  value = 0;
+  for (int shift(0); shift < 64; shift += 7) {
+    auto next(source.get());
+    if (next == std::char_traits<char>::eof())
+      return false;
+    value |= static_cast<uint64_t>(next & 0x7F) << shift;
+    if ((next & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+DataMap DecryptUsingVersion0(DataMapKeys& keys,
                              const protobuf::EncryptedDataMap& protobuf_encrypted_data_map) {
   if (protobuf_encrypted_data_map.data_map_encryption_version() !=
       static_cast<uint32_t>(EncryptionAlgorithm::kDataMapEncryptionVersion0)) {
     BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::invalid_encryption_version));
   }
 
-  size_t inputs_size(parent_id.string().size() + this_id.string().size());
-  ByteVector enc_hash(crypto::SHA512::DIGESTSIZE);
-  ByteVector xor_hash(crypto::SHA512::DIGESTSIZE);
-
-  CryptoPP::SHA512().CalculateDigest(
-      &enc_hash.data()[0],
-      reinterpret_cast<const byte*>((parent_id.string() + this_id.string()).data()), inputs_size);
-  CryptoPP::SHA512().CalculateDigest(
-      &xor_hash.data()[0],
-      reinterpret_cast<const byte*>((this_id.string() + parent_id.string()).data()), inputs_size);
-
   CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption decryptor(
-      &enc_hash.data()[0], crypto::AES256_KeySize, &enc_hash.data()[crypto::AES256_KeySize]);
+      keys.enc_hash.data(), crypto::AES256_KeySize, keys.enc_hash.data() + crypto::AES256_KeySize);
 
   std::string serialised_data_map;
 
@@ -90,73 +317,245 @@ DataMap DecryptUsingVersion0(const Identity& parent_id, const Identity& this_id,
       new XORFilter(
           new CryptoPP::StreamTransformationFilter(
               decryptor, new CryptoPP::StringSink(serialised_data_map)),
-          &xor_hash.data()[0], crypto::SHA512::DIGESTSIZE));
+          keys.xor_hash.data(), crypto::SHA512::DIGESTSIZE));
 
   DataMap data_map;
   ParseDataMap(serialised_data_map, data_map);
   return data_map;
 }
 
-}  // unnamed namespace
+DataMap DecryptUsingVersion1(DataMapKeys& keys,
+                             const protobuf::EncryptedDataMap& protobuf_encrypted_data_map) {
+  if (protobuf_encrypted_data_map.data_map_encryption_version() !=
+      static_cast<uint32_t>(EncryptionAlgorithm::kDataMapEncryptionVersion1)) {
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::invalid_encryption_version));
+  }
 
-crypto::CipherText EncryptDataMap(const Identity& parent_id, const Identity& this_id,
-                                  const DataMap& data_map) {
-  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
-  assert(this_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption decryptor(
+      keys.enc_hash.data(), crypto::AES256_KeySize, keys.enc_hash.data() + crypto::AES256_KeySize);
 
+  std::string serialised_data_map;
+  try {
+    CryptoPP::StringSource filter(
+        protobuf_encrypted_data_map.contents(), true,
+        new XORFilter(new CryptoPP::StreamTransformationFilter(
+                          decryptor, new CryptoPP::Gunzip(
+                                         new CryptoPP::StringSink(serialised_data_map))),
+                      keys.xor_hash.data(), crypto::SHA512::DIGESTSIZE));
+  }
+  catch (const CryptoPP::Exception& e) {
+    LOG(kWarning) << "Failed to decompress data map: " << e.what();
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::failed_to_decrypt));
+  }
+
+  DataMap data_map;
+  ParseDataMap(serialised_data_map, data_map);
+  return data_map;
+}
+
+crypto::CipherText EncryptUsingKeys(DataMapKeys& keys, const DataMap& data_map) {
   std::string serialised_data_map;
   SerialiseDataMap(data_map, serialised_data_map);
-  ByteVector ser_data_map(std::begin(serialised_data_map), std::end(serialised_data_map));
-  size_t inputs_size(parent_id.string().size() + this_id.string().size());
-  ByteVector enc_hash(crypto::SHA512::DIGESTSIZE);
-  ByteVector xor_hash(crypto::SHA512::DIGESTSIZE);
-
-  CryptoPP::SHA512().CalculateDigest(
-      &enc_hash.data()[0], reinterpret_cast<const
-      byte*>((parent_id.string() + this_id.string()).data()), inputs_size);
-  CryptoPP::SHA512().CalculateDigest(
-      &xor_hash.data()[0], reinterpret_cast<const
-      byte*>((this_id.string() + parent_id.string()).data()), inputs_size);
 
   CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(
-      &enc_hash.data()[0], crypto::AES256_KeySize, &enc_hash.data()[crypto::AES256_KeySize]);
+      keys.enc_hash.data(), crypto::AES256_KeySize, keys.enc_hash.data() + crypto::AES256_KeySize);
 
   protobuf::EncryptedDataMap protobuf_encrypted_data_map;
   protobuf_encrypted_data_map.set_data_map_encryption_version(
       static_cast<uint32_t>(kDataMapEncryptionVersion));
-  CryptoPP::StreamTransformationFilter aes_filter(
+  CryptoPP::Gzip aes_filter(
+      new CryptoPP::StreamTransformationFilter(
           encryptor,
           new XORFilter(new CryptoPP::StringSink(*protobuf_encrypted_data_map.mutable_contents()),
-                        &xor_hash.data()[0], crypto::SHA512::DIGESTSIZE));
-aes_filter.Put2(&ser_data_map.data()[0],
-                  ser_data_map.size(), -1, true);
+                        keys.xor_hash.data(), crypto::SHA512::DIGESTSIZE)),
+      kDataMapCompressionLevel);
+  aes_filter.Put2(reinterpret_cast<const byte*>(serialised_data_map.data()),
+                  serialised_data_map.size(), -1, true);
 
   assert(!protobuf_encrypted_data_map.contents().empty());
 
   return crypto::CipherText(NonEmptyString(protobuf_encrypted_data_map.SerializeAsString()));
 }
 
+DataMap DecryptUsingKeys(DataMapKeys& keys, const std::string& encrypted_data_map) {
+  protobuf::EncryptedDataMap protobuf_encrypted_data_map;
+  if (!protobuf_encrypted_data_map.ParseFromString(encrypted_data_map))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  // Don't switch here - just assume most current encryption version is being used and try
+  // progressively older versions until one works
+  try {
+    return DecryptUsingVersion1(keys, protobuf_encrypted_data_map);
+  }
+  catch (const encrypt_error& error) {
+    if (error.code() != MakeError(EncryptErrors::invalid_encryption_version).code())
+      throw;
+  }
+
+  return DecryptUsingVersion0(keys, protobuf_encrypted_data_map);
+}
+
+// Splits [0, count) into one contiguous range per worker thread and calls |functor| for each index,
+// returning the results in index order.  Exceptions from |functor| propagate to the caller.
+template <typename Result, typename Functor>
+std::vector<Result> RunInParallel(size_t count, Functor functor) {
+  std::vector<Result> results;
+  results.reserve(count);
+  size_t num_workers(std::min(count, static_cast<size_t>(std::max(Concurrency(), 1))));
+  std::vector<std::future<std::vector<Result>>> workers;
+  size_t begin(0);
+  for (size_t worker(0); worker != num_workers; ++worker) {
+    size_t end(begin + (count - begin) / (num_workers - worker));
+    workers.emplace_back(std::async(std::launch::async, [=]() {
+      std::vector<Result> part;
+      part.reserve(end - begin);
+      for (size_t i(begin); i != end; ++i)
+        part.push_back(functor(i));
+      return part;
+    }));
+    begin = end;
+  }
+  for (auto& worker : workers) {
+    auto part(worker.get());
+    std::move(std::begin(part), std::end(part), std::back_inserter(results));
+  }
+  return results;
+}
+
+}  // unnamed namespace
+
+crypto::CipherText EncryptDataMap(const Identity& parent_id, const Identity& this_id,
+                                  const DataMap& data_map) {
+  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  assert(this_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+
+  DataMapKeys keys;
+  GetDataMapKeys(parent_id, this_id, keys);
+  return EncryptUsingKeys(keys, data_map);
+}
+
 DataMap DecryptDataMap(const Identity& parent_id, const Identity& this_id,
                        const std::string& encrypted_data_map) {
   assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
   assert(this_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
   assert(!encrypted_data_map.empty());
 
-  protobuf::EncryptedDataMap protobuf_encrypted_data_map;
-  if (!protobuf_encrypted_data_map.ParseFromString(encrypted_data_map))
+  DataMapKeys keys;
+  GetDataMapKeys(parent_id, this_id, keys);
+  return DecryptUsingKeys(keys, encrypted_data_map);
+}
+
+std::vector<crypto::CipherText> EncryptDataMaps(
+    const Identity& parent_id, const std::vector<std::pair<Identity, DataMap>>& data_maps) {
+  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  CryptoPP::SHA512 parent_hash;
+  HashUpdate(parent_hash, parent_id);
+  return RunInParallel<crypto::CipherText>(data_maps.size(), [&](size_t i) {
+    assert(data_maps[i].first.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+    DataMapKeys keys;
+    GetDataMapKeys(parent_hash, parent_id, data_maps[i].first, keys);
+    return EncryptUsingKeys(keys, data_maps[i].second);
+  });
+}
+
+std::vector<DataMap> DecryptDataMaps(
+    const Identity& parent_id,
+    const std::vector<std::pair<Identity, std::string>>& encrypted_data_maps) {
+  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  CryptoPP::SHA512 parent_hash;
+  HashUpdate(parent_hash, parent_id);
+  return RunInParallel<DataMap>(encrypted_data_maps.size(), [&](size_t i) {
+    assert(encrypted_data_maps[i].first.string().size() ==
+           static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+    DataMapKeys keys;
+    GetDataMapKeys(parent_hash, parent_id, encrypted_data_maps[i].first, keys);
+    return DecryptUsingKeys(keys, encrypted_data_maps[i].second);
+  });
+}
+
+void EncryptDataMap(const Identity& parent_id, const Identity& this_id, const DataMap& data_map,
+                    std::ostream& sink) {
+  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  assert(this_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+
+  // The length of the contents precedes them, so the map is compressed once just to measure it
+  // rather than buffering the compressed map.
+  CryptoPP::MeterFilter* compressed_meter(new CryptoPP::MeterFilter(new CryptoPP::BitBucket));
+  CryptoPP::Gzip measure_filter(compressed_meter, kDataMapCompressionLevel);
+  if (!WriteDataMap(data_map, measure_filter))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  uint64_t contents_size(compressed_meter->GetTotalBytes());
+  if (contents_size > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+
+  // Header of the protobuf::EncryptedDataMap, up to and including the length of its contents.
+  std::string header;
+  {
+    google::protobuf::io::StringOutputStream header_stream(&header);
+    CodedOutputStream header_output(&header_stream);
+    header_output.WriteTag(kVersionTag);
+    header_output.WriteVarint32(static_cast<uint32_t>(kDataMapEncryptionVersion));
+    header_output.WriteTag(kContentsTag);
+    header_output.WriteVarint64(contents_size);
+  }
+  sink.write(header.data(), header.size());
+
+  DataMapKeys keys;
+  GetDataMapKeys(parent_id, this_id, keys);
+  CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(
+      keys.enc_hash.data(), crypto::AES256_KeySize, keys.enc_hash.data() + crypto::AES256_KeySize);
+  CryptoPP::MeterFilter* written_meter(new CryptoPP::MeterFilter(new CryptoPP::FileSink(sink)));
+  CryptoPP::Gzip aes_filter(
+      new CryptoPP::StreamTransformationFilter(
+          encryptor,
+          new XORFilter(written_meter, keys.xor_hash.data(), crypto::SHA512::DIGESTSIZE)),
+      kDataMapCompressionLevel);
+  if (!WriteDataMap(data_map, aes_filter) || written_meter->GetTotalBytes() != contents_size ||
+      !sink.good()) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  }
+}
+
+DataMap DecryptDataMap(const Identity& parent_id, const Identity& this_id, std::istream& source) {
+  assert(parent_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+  assert(this_id.string().size() == static_cast<size_t>(crypto::SHA512::DIGESTSIZE));
+
+  // Parse the protobuf::EncryptedDataMap header by hand so that the contents are never buffered.
+  uint64_t tag(0), version(0), contents_size(0);
+  if (!ReadVarint(source, tag) || tag != kVersionTag || !ReadVarint(source, version) ||
+      !ReadVarint(source, tag) || tag != kContentsTag || !ReadVarint(source, contents_size)) {
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  bool compressed(version ==
+                  static_cast<uint64_t>(EncryptionAlgorithm::kDataMapEncryptionVersion1));
+  if (!compressed &&
+      version != static_cast<uint64_t>(EncryptionAlgorithm::kDataMapEncryptionVersion0)) {
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::invalid_encryption_version));
+  }
 
-  // Don't switch here - just assume most current encryption version is being used and try
-  // progressively older versions until one works
-  // try {
-  //   return DecryptUsingVersion1(parent_id, this_id, protobuf_encrypted_data_map);
-  // }
-  // catch (const encrypt_error& error) {
-  //   if (error.code() != MakeError(EncryptErrors::invalid_encryption_version).code())
-  //     throw;
-  // }
-
-  return DecryptUsingVersion0(parent_id, this_id, protobuf_encrypted_data_map);
+  DataMapKeys keys;
+  GetDataMapKeys(parent_id, this_id, keys);
+  CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption decryptor(
+      keys.enc_hash.data(), crypto::AES256_KeySize, keys.enc_hash.data() + crypto::AES256_KeySize);
+  CryptoPP::MessageQueue* serialised_data_map(new CryptoPP::MessageQueue);
+  CryptoPP::BufferedTransformation* decompressor(serialised_data_map);
+  if (compressed)
+    decompressor = new CryptoPP::Gunzip(serialised_data_map);
+  XORFilter filter(new CryptoPP::StreamTransformationFilter(decryptor, decompressor),
+                   keys.xor_hash.data(), crypto::SHA512::DIGESTSIZE);
+  FilterInputStream filter_stream(source, contents_size, filter, *serialised_data_map);
+  google::protobuf::io::CopyingInputStreamAdaptor adaptor(&filter_stream,
+                                                          static_cast<int>(kStreamBufferSize));
+  try {
+    DataMap data_map(ReadDataMap(adaptor));
+    if (!filter_stream.AllRead())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return data_map;
+  }
+  catch (const CryptoPP::Exception& e) {
+    LOG(kWarning) << "Failed to decompress data map: " << e.what();
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::failed_to_decrypt));
+  }
 }
 
 }  // namespace encrypt
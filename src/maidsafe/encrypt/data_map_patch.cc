@@ -0,0 +1,214 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/data_map_patch.h"
+
+#include <utility>
+
+#ifdef __MSVC__
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/sha.h"
+#ifdef __MSVC__
+#pragma warning(pop)
+#endif
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/encrypt/data_map_encryptor.h"
+#include "maidsafe/encrypt/data_map.pb.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+bool Equal(const ChunkDetails& lhs, const ChunkDetails& rhs) {
+  return lhs.size == rhs.size && lhs.storage_state == rhs.storage_state && lhs.hash == rhs.hash &&
+         lhs.pre_hash == rhs.pre_hash;
+}
+
+std::string ToString(const ByteVector& bytes) {
+  return std::string(std::begin(bytes), std::end(bytes));
+}
+
+ByteVector ToByteVector(const std::string& bytes) {
+  return ByteVector(std::begin(bytes), std::end(bytes));
+}
+
+void HashNumber(uint64_t number, CryptoPP::SHA512& hash) {
+  byte bytes[8];
+  for (int i(0); i != 8; ++i)
+    bytes[i] = static_cast<byte>(number >> (8 * i));
+  hash.Update(bytes, sizeof(bytes));
+}
+
+void HashBytes(const ByteVector& bytes, CryptoPP::SHA512& hash) {
+  HashNumber(bytes.size(), hash);
+  hash.Update(bytes.data(), bytes.size());
+}
+
+// Hashes the data map's fields directly rather than serialising it, so fingerprinting the base
+// costs a fraction of the full round trip a patch is meant to save.  A chunk's hash is of its
+// encrypted content, which is keyed by its own and its two predecessors' pre-hashes, so those
+// needn't be hashed again; and a Merkle root, where there is one, stands for every chunk's hash.
+ByteVector HashDataMap(const DataMap& data_map) {
+  CryptoPP::SHA512 hash;
+  HashNumber(static_cast<uint32_t>(data_map.self_encryption_version), hash);
+  HashNumber(data_map.chunks.size(), hash);
+  if (!data_map.merkle_root.empty()) {
+    HashBytes(data_map.merkle_root, hash);
+  } else {
+    for (const auto& chunk : data_map.chunks) {
+      HashBytes(chunk.hash, hash);
+      HashNumber(static_cast<uint64_t>(chunk.storage_state) << 32 | chunk.size, hash);
+    }
+  }
+  HashBytes(data_map.content, hash);
+  ByteVector digest(crypto::SHA512::DIGESTSIZE);
+  hash.Final(&digest[0]);
+  return digest;
+}
+
+}  // unnamed namespace
+
+DataMapPatch::DataMapPatch()
+    : self_encryption_version(kSelfEncryptionVersion),
+      base_num_chunks(0),
+      base_hash(),
+      num_chunks(0),
+      changed_chunks(),
+      content(),
+      merkle_root() {}
+
+DataMapPatch::DataMapPatch(DataMapPatch&& other) MAIDSAFE_NOEXCEPT
+    : self_encryption_version(std::move(other.self_encryption_version)),
+      base_num_chunks(std::move(other.base_num_chunks)),
+      base_hash(std::move(other.base_hash)),
+      num_chunks(std::move(other.num_chunks)),
+      changed_chunks(std::move(other.changed_chunks)),
+      content(std::move(other.content)),
+      merkle_root(std::move(other.merkle_root)) {}
+
+DataMapPatch DiffDataMaps(const DataMap& old_data_map, const DataMap& new_data_map) {
+  DataMapPatch patch;
+  patch.self_encryption_version = new_data_map.self_encryption_version;
+  patch.base_num_chunks = static_cast<uint32_t>(old_data_map.chunks.size());
+  patch.base_hash = HashDataMap(old_data_map);
+  patch.num_chunks = static_cast<uint32_t>(new_data_map.chunks.size());
+  for (uint32_t i(0); i != patch.num_chunks; ++i) {
+    if (i >= patch.base_num_chunks || !Equal(old_data_map.chunks[i], new_data_map.chunks[i]))
+      patch.changed_chunks.emplace_back(i, new_data_map.chunks[i]);
+  }
+  patch.content = new_data_map.content;
+  patch.merkle_root = new_data_map.merkle_root;
+  return patch;
+}
+
+void ApplyPatch(const DataMapPatch& patch, DataMap& data_map) {
+  if (data_map.chunks.size() != patch.base_num_chunks) {
+    LOG(kWarning) << "Patch is for a data map of " << patch.base_num_chunks << " chunks, not "
+                  << data_map.chunks.size();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  if (HashDataMap(data_map) != patch.base_hash) {
+    LOG(kWarning) << "Patch is for a different data map of " << patch.base_num_chunks << " chunks";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  // Validate before modifying |data_map|: indices must be ascending and in range, and every chunk
+  // beyond the base must be supplied.
+  uint32_t num_new_chunks(0);
+  for (size_t i(0); i != patch.changed_chunks.size(); ++i) {
+    uint32_t index(patch.changed_chunks[i].first);
+    if (index >= patch.num_chunks || (i != 0 && index <= patch.changed_chunks[i - 1].first)) {
+      LOG(kWarning) << "Invalid chunk index " << index << " in patch";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    if (index >= patch.base_num_chunks)
+      ++num_new_chunks;
+  }
+  if (patch.num_chunks > patch.base_num_chunks &&
+      num_new_chunks != patch.num_chunks - patch.base_num_chunks) {
+    LOG(kWarning) << "Patch is missing some of its new chunks";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+
+  data_map.self_encryption_version = patch.self_encryption_version;
+  data_map.chunks.resize(patch.num_chunks);
+  for (const auto& changed_chunk : patch.changed_chunks)
+    data_map.chunks[changed_chunk.first] = changed_chunk.second;
+  data_map.content = patch.content;
+  data_map.merkle_root = patch.merkle_root;
+}
+
+void SerialiseDataMapPatch(const DataMapPatch& patch, std::string& serialised_patch) {
+  protobuf::DataMapPatch proto_patch;
+  proto_patch.set_self_encryption_version(static_cast<uint32_t>(patch.self_encryption_version));
+  proto_patch.set_base_num_chunks(patch.base_num_chunks);
+  proto_patch.set_base_hash(ToString(patch.base_hash));
+  proto_patch.set_num_chunks(patch.num_chunks);
+  for (const auto& changed_chunk : patch.changed_chunks) {
+    proto_patch.add_changed_indices(changed_chunk.first);
+    protobuf::ChunkDetails* chunk_details(proto_patch.add_changed_chunks());
+    chunk_details->set_hash(ToString(changed_chunk.second.hash));
+    chunk_details->set_pre_hash(ToString(changed_chunk.second.pre_hash));
+    chunk_details->set_size(changed_chunk.second.size);
+    chunk_details->set_storage_state(changed_chunk.second.storage_state);
+  }
+  if (!patch.content.empty())
+    proto_patch.set_content(ToString(patch.content));
+  if (!patch.merkle_root.empty())
+    proto_patch.set_merkle_root(ToString(patch.merkle_root));
+  if (!proto_patch.SerializeToString(&serialised_patch))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+}
+
+void ParseDataMapPatch(const std::string& serialised_patch, DataMapPatch& patch) {
+  protobuf::DataMapPatch proto_patch;
+  if (!proto_patch.ParseFromString(serialised_patch) ||
+      proto_patch.changed_indices_size() != proto_patch.changed_chunks_size()) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  patch.self_encryption_version =
+      static_cast<EncryptionAlgorithm>(proto_patch.self_encryption_version());
+  patch.base_num_chunks = proto_patch.base_num_chunks();
+  patch.base_hash = ToByteVector(proto_patch.base_hash());
+  patch.num_chunks = proto_patch.num_chunks();
+  patch.changed_chunks.clear();
+  patch.changed_chunks.reserve(proto_patch.changed_chunks_size());
+  for (int n(0); n < proto_patch.changed_chunks_size(); ++n) {
+    const protobuf::ChunkDetails& proto_chunk(proto_patch.changed_chunks(n));
+    ChunkDetails chunk;
+    chunk.hash = ToByteVector(proto_chunk.hash());
+    chunk.pre_hash = ToByteVector(proto_chunk.pre_hash());
+    chunk.size = proto_chunk.size();
+    chunk.storage_state = static_cast<ChunkDetails::StorageState>(proto_chunk.storage_state());
+    patch.changed_chunks.emplace_back(proto_patch.changed_indices(n), std::move(chunk));
+  }
+  patch.content = ToByteVector(proto_patch.content());
+  patch.merkle_root = ToByteVector(proto_patch.merkle_root());
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,180 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/merkle_tree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#ifdef __MSVC__
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/sha.h"
+#ifdef __MSVC__
+#pragma warning(pop)
+#endif
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+const size_t kDigestSize(crypto::SHA512::DIGESTSIZE);
+// Leaves and interior nodes are hashed with different prefixes so one can't be passed off as the
+// other in an inclusion proof.
+const byte kLeafPrefix(0);
+const byte kNodePrefix(1);
+
+void HashLeaf(const ByteVector& chunk_hash, byte* leaf) {
+  CryptoPP::SHA512 hash;
+  hash.Update(&kLeafPrefix, 1);
+  if (!chunk_hash.empty())
+    hash.Update(&chunk_hash.data()[0], chunk_hash.size());
+  hash.Final(leaf);
+}
+
+void HashNode(const byte* left, const byte* right, byte* node) {
+  CryptoPP::SHA512 hash;
+  hash.Update(&kNodePrefix, 1);
+  hash.Update(left, kDigestSize);
+  hash.Update(right, kDigestSize);
+  hash.Final(node);
+}
+
+uint32_t TreeWidth(uint32_t num_leaves) {
+  uint32_t width(num_leaves == 0 ? 0 : 1);
+  while (width < num_leaves)
+    width <<= 1;
+  return width;
+}
+
+// Extends the last range if |first| is contiguous with it.
+void AddRange(uint32_t first, uint32_t last, std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+  if (first >= last)
+    return;
+  if (!ranges.empty() && ranges.back().second == first)
+    ranges.back().second = last;
+  else
+    ranges.emplace_back(first, last);
+}
+
+}  // unnamed namespace
+
+MerkleTree::MerkleTree(const DataMap& data_map)
+    : num_leaves_(static_cast<uint32_t>(data_map.chunks.size())),
+      width_(TreeWidth(num_leaves_)),
+      nodes_(2 * static_cast<size_t>(width_) * kDigestSize) {
+  if (width_ == 0)
+    return;
+  for (uint32_t i(0); i != num_leaves_; ++i)
+    HashLeaf(data_map.chunks[i].hash, &nodes_[(width_ + i) * kDigestSize]);
+  if (num_leaves_ != width_) {
+    byte padding[kDigestSize];
+    HashLeaf(ByteVector(), padding);
+    for (uint32_t i(num_leaves_); i != width_; ++i)
+      std::memcpy(&nodes_[(width_ + i) * kDigestSize], padding, kDigestSize);
+  }
+  for (uint32_t i(width_ - 1); i != 0; --i) {
+    HashNode(&nodes_[2 * i * kDigestSize], &nodes_[(2 * i + 1) * kDigestSize],
+             &nodes_[i * kDigestSize]);
+  }
+}
+
+ByteVector MerkleTree::root() const {
+  if (width_ == 0)
+    return ByteVector();
+  return ByteVector(&nodes_[kDigestSize], &nodes_[kDigestSize] + kDigestSize);
+}
+
+std::vector<ByteVector> MerkleTree::InclusionProof(uint32_t chunk_index) const {
+  if (chunk_index >= num_leaves_) {
+    LOG(kWarning) << "No chunk " << chunk_index << " in tree of " << num_leaves_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  std::vector<ByteVector> proof;
+  for (size_t node(width_ + chunk_index); node != 1; node >>= 1) {
+    const byte* sibling(&nodes_[(node ^ 1) * kDigestSize]);
+    proof.emplace_back(sibling, sibling + kDigestSize);
+  }
+  return proof;
+}
+
+bool MerkleTree::VerifyInclusionProof(const ByteVector& root, const ByteVector& chunk_hash,
+                                      uint32_t chunk_index, const std::vector<ByteVector>& proof) {
+  if (root.size() != kDigestSize || proof.size() > 32 ||
+      (proof.size() < 32 && (chunk_index >> proof.size()) != 0)) {
+    return false;
+  }
+  ByteVector node(kDigestSize), parent(kDigestSize);
+  HashLeaf(chunk_hash, &node[0]);
+  for (const auto& sibling : proof) {
+    if (sibling.size() != kDigestSize)
+      return false;
+    if (chunk_index & 1)
+      HashNode(&sibling[0], &node[0], &parent[0]);
+    else
+      HashNode(&node[0], &sibling[0], &parent[0]);
+    std::swap(node, parent);
+    chunk_index >>= 1;
+  }
+  return node == root;
+}
+
+const byte* MerkleTree::Node(uint32_t first_leaf, uint32_t width) const {
+  assert(width != 0 && first_leaf % width == 0 && first_leaf + width <= width_);
+  return &nodes_[(static_cast<size_t>(width_ / width) + first_leaf / width) * kDigestSize];
+}
+
+void MerkleTree::AddChangedRanges(const MerkleTree& lhs, const MerkleTree& rhs,
+                                  uint32_t first_leaf, uint32_t width,
+                                  std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+  const byte* lhs_node(lhs.Node(first_leaf, width));
+  if (std::equal(lhs_node, lhs_node + kDigestSize, rhs.Node(first_leaf, width)))
+    return;
+  if (width == 1) {
+    AddRange(first_leaf, first_leaf + 1, ranges);
+    return;
+  }
+  AddChangedRanges(lhs, rhs, first_leaf, width / 2, ranges);
+  AddChangedRanges(lhs, rhs, first_leaf + width / 2, width / 2, ranges);
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> ChangedChunkRanges(const MerkleTree& lhs,
+                                                              const MerkleTree& rhs) {
+  // The narrower tree is compared with the same-sized subtree at the start of the wider one, and
+  // every chunk beyond that is new.
+  const MerkleTree& narrow(lhs.width_ <= rhs.width_ ? lhs : rhs);
+  const MerkleTree& wide(lhs.width_ <= rhs.width_ ? rhs : lhs);
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  if (narrow.width_ != 0)
+    MerkleTree::AddChangedRanges(narrow, wide, 0, narrow.width_, ranges);
+  AddRange(narrow.width_, wide.num_leaves_, ranges);
+  return ranges;
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,124 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/scrubber.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iterator>
+#include <utility>
+
+#ifdef __MSVC__
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/sha.h"
+#ifdef __MSVC__
+#pragma warning(pop)
+#endif
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+bool HashMatches(const ByteVector& name, const std::string& content) {
+  if (name.size() != crypto::SHA512::DIGESTSIZE)
+    return false;
+  byte digest[crypto::SHA512::DIGESTSIZE];
+  CryptoPP::SHA512().CalculateDigest(digest, reinterpret_cast<const byte*>(content.data()),
+                                     content.size());
+  return std::equal(std::begin(name), std::end(name), digest);
+}
+
+}  // unnamed namespace
+
+ScrubReport ScrubDataMaps(const std::vector<DataMap>& data_maps,
+                          std::function<NonEmptyString(const std::string&)> get_from_store,
+                          int max_concurrent_fetches) {
+  if (!get_from_store || max_concurrent_fetches < 1) {
+    LOG(kError) << "Need a non-null get_from_store functor and at least one concurrent fetch.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+
+  std::vector<const ByteVector*> names;
+  for (const auto& data_map : data_maps) {
+    for (const auto& chunk : data_map.chunks)
+      names.push_back(&chunk.hash);
+  }
+  auto less([](const ByteVector* lhs, const ByteVector* rhs) { return *lhs < *rhs; });
+  auto equal([](const ByteVector* lhs, const ByteVector* rhs) { return *lhs == *rhs; });
+  std::sort(std::begin(names), std::end(names), less);
+  names.erase(std::unique(std::begin(names), std::end(names), equal), std::end(names));
+
+  // Each worker takes the next unchecked name until none are left, so a slow fetch only holds up
+  // its own worker.
+  std::atomic<size_t> next_name(0);
+  auto scrub([&]() -> ScrubReport {
+    ScrubReport report;
+    for (size_t i(next_name++); i < names.size(); i = next_name++) {
+      const ByteVector& name(*names[i]);
+      ++report.chunks_checked;
+      NonEmptyString content;
+      try {
+        content = get_from_store(std::string(std::begin(name), std::end(name)));
+      }
+      catch (const std::exception& e) {
+        LOG(kWarning) << "Chunk " << HexSubstr(std::string(std::begin(name), std::end(name)))
+                      << " missing: " << boost::diagnostic_information(e);
+        report.missing_chunks.push_back(name);
+        continue;
+      }
+      report.bytes_checked += content.string().size();
+      if (!HashMatches(name, content.string())) {
+        LOG(kWarning) << "Chunk " << HexSubstr(std::string(std::begin(name), std::end(name)))
+                      << " corrupt";
+        report.corrupt_chunks.push_back(name);
+      }
+    }
+    return report;
+  });
+
+  size_t num_workers(std::min(static_cast<size_t>(max_concurrent_fetches), names.size()));
+  std::vector<std::future<ScrubReport>> workers;
+  for (size_t i(1); i < num_workers; ++i)
+    workers.emplace_back(std::async(std::launch::async, scrub));
+  ScrubReport report(scrub());
+  for (auto& worker : workers) {
+    ScrubReport worker_report(worker.get());
+    report.chunks_checked += worker_report.chunks_checked;
+    report.bytes_checked += worker_report.bytes_checked;
+    std::move(std::begin(worker_report.missing_chunks), std::end(worker_report.missing_chunks),
+              std::back_inserter(report.missing_chunks));
+    std::move(std::begin(worker_report.corrupt_chunks), std::end(worker_report.corrupt_chunks),
+              std::back_inserter(report.corrupt_chunks));
+  }
+  std::sort(std::begin(report.missing_chunks), std::end(report.missing_chunks));
+  std::sort(std::begin(report.corrupt_chunks), std::end(report.corrupt_chunks));
+  return report;
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,173 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/self_decryptor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <utility>
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/encrypt/chunk_crypto.h"
+#include "maidsafe/encrypt/stats_counters.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+// The most chunks a single Read fetches at once.
+const uint32_t kMaxConcurrentFetches(8);
+
+std::vector<uint64_t> ChunkOffsets(const DataMap& data_map) {
+  if (!data_map.chunks.empty() && data_map.chunks.size() < 3) {
+    LOG(kError) << "A data map needs at least 3 chunks, not " << data_map.chunks.size();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  std::vector<uint64_t> offsets(1, 0);
+  for (const auto& chunk : data_map.chunks) {
+    if (chunk.pre_hash.size() != crypto::SHA512::DIGESTSIZE) {
+      LOG(kError) << "Chunk " << offsets.size() - 1 << " has no valid pre-hash.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    offsets.push_back(offsets.back() + chunk.size);
+  }
+  return offsets;
+}
+
+}  // unnamed namespace
+
+SelfDecryptor::SelfDecryptor(DataMap data_map,
+                             std::function<NonEmptyString(const std::string&)> get_from_store,
+                             std::shared_ptr<ChunkCache> cache)
+    : kDataMap_(std::move(data_map)),
+      kChunkOffsets_(ChunkOffsets(kDataMap_)),
+      kSize_(kDataMap_.chunks.empty() ? kDataMap_.content.size() : kChunkOffsets_.back()),
+      kGetFromStore_(get_from_store),
+      kCache_(std::move(cache)),
+      stats_(new StatsCounters) {
+  if (!kGetFromStore_) {
+    LOG(kError) << "Need to have a non-null get_from_store functor.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+}
+
+SelfDecryptor::~SelfDecryptor() {}
+
+SelfEncryptorStats SelfDecryptor::stats() const { return stats_->Snapshot(); }
+
+bool SelfDecryptor::Read(char* data, uint32_t length, uint64_t position) const {
+  if (position + length > kSize_)
+    return false;
+  if (kDataMap_.chunks.empty()) {
+    std::copy_n(kDataMap_.content.data() + position, length, reinterpret_cast<byte*>(data));
+    stats_->Add(StatsCounters::kBytesRead, length);
+    return true;
+  }
+  if (length == 0)
+    return true;
+
+  auto copy_chunk([=](uint32_t chunk_number, const ChunkCache::Chunk& chunk) {
+    uint64_t begin(std::max(position, kChunkOffsets_[chunk_number]));
+    uint64_t end(std::min(position + length, kChunkOffsets_[chunk_number + 1]));
+    std::memcpy(data + (begin - position), chunk->data() + (begin - kChunkOffsets_[chunk_number]),
+                static_cast<size_t>(end - begin));
+  });
+
+  // Cached chunks are copied straight away; only those which must be fetched are worth a thread.
+  std::vector<uint32_t> to_fetch;
+  for (uint32_t i(GetChunkNumber(position)); i <= GetChunkNumber(position + length - 1); ++i) {
+    ChunkCache::Chunk cached(kCache_ ? kCache_->Get(kDataMap_.chunks[i].hash) : nullptr);
+    if (cached) {
+      stats_->Add(StatsCounters::kCacheHits, 1);
+      copy_chunk(i, cached);
+    } else {
+      to_fetch.push_back(i);
+    }
+  }
+
+  // Each worker takes the next chunk not yet started, so however long the Read, no more than
+  // kMaxConcurrentFetches chunks are fetched or held at once.
+  std::atomic<size_t> next(0);
+  auto fetch_chunks([&] {
+    for (size_t i(next++); i < to_fetch.size(); i = next++)
+      copy_chunk(to_fetch[i], GetChunk(to_fetch[i]));
+  });
+  std::vector<std::future<void>> workers;
+  for (size_t i(1); i < std::min<size_t>(to_fetch.size(), kMaxConcurrentFetches); ++i)
+    workers.emplace_back(std::async(std::launch::async, fetch_chunks));
+  fetch_chunks();
+  for (auto& worker : workers)
+    worker.get();
+  stats_->Add(StatsCounters::kBytesRead, length);
+  return true;
+}
+
+ChunkCache::Chunk SelfDecryptor::GetChunk(uint32_t chunk_number) const {
+  auto decrypt([=] { return std::make_shared<const ByteVector>(DecryptChunk(chunk_number)); });
+  if (!kCache_)
+    return decrypt();
+  // A Read which finds the chunk cached, or waits for another Read's fetch of it, counts a hit.
+  bool fetched(false);
+  ChunkCache::Chunk chunk(kCache_->GetOrLoad(kDataMap_.chunks[chunk_number].hash, [&] {
+    fetched = true;
+    return decrypt();
+  }));
+  if (!fetched)
+    stats_->Add(StatsCounters::kCacheHits, 1);
+  return chunk;
+}
+
+ByteVector SelfDecryptor::DecryptChunk(uint32_t chunk_number) const {
+  const uint32_t kNumChunks(static_cast<uint32_t>(kDataMap_.chunks.size()));
+  const ChunkDetails& chunk(kDataMap_.chunks[chunk_number]);
+  const ChunkDetails& n_1_chunk(kDataMap_.chunks[(chunk_number + kNumChunks - 1) % kNumChunks]);
+  const ChunkDetails& n_2_chunk(kDataMap_.chunks[(chunk_number + kNumChunks - 2) % kNumChunks]);
+  ByteVector key, iv, pad;
+  GetPadIvKey(chunk.pre_hash, n_1_chunk.pre_hash, n_2_chunk.pre_hash, key, iv, pad);
+  NonEmptyString content;
+  {
+    StageTimer timer(*stats_, StatsCounters::kFetchTime);
+    content = kGetFromStore_(std::string(std::begin(chunk.hash), std::end(chunk.hash)));
+  }
+  stats_->Add(StatsCounters::kChunksFetched, 1);
+  ByteVector data(chunk.size);
+  {
+    StageTimer timer(*stats_, StatsCounters::kDecryptTime);
+    DecryptChunkContent(content.string(), key, iv, pad, data.data(), chunk.size);
+  }
+  stats_->Add(StatsCounters::kChunksDecrypted, 1);
+  return data;
+}
+
+uint32_t SelfDecryptor::GetChunkNumber(uint64_t position) const {
+  return static_cast<uint32_t>(
+      std::upper_bound(std::begin(kChunkOffsets_), std::end(kChunkOffsets_), position) -
+      std::begin(kChunkOffsets_) - 1);
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -20,11 +20,13 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <string>
 #include <utility>
 #include <memory>
 #include <functional>
 #include <future>
+#include <tuple>
 
 #ifdef __MSVC__
 #pragma warning(push, 1)
@@ -48,8 +50,15 @@
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/encrypt/chunk_crypto.h"
+#include "maidsafe/encrypt/chunk_range_locks.h"
+#include "maidsafe/encrypt/chunk_status_table.h"
 #include "maidsafe/encrypt/data_map_encryptor.h"
+#include "maidsafe/encrypt/merkle_tree.h"
 #include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/sequencer.h"
+#include "maidsafe/encrypt/stats_counters.h"
+#include "maidsafe/encrypt/tracer.h"
 #include "maidsafe/encrypt/xor.h"
 #include "maidsafe/encrypt/data_map.pb.h"
 
@@ -57,57 +66,117 @@ namespace maidsafe {
 
 namespace encrypt {
 
+namespace {
+
+#ifndef WIN32
+uint32_t TotalLength(const iovec* buffers, int count) {
+  uint64_t length(0);
+  for (int i(0); i < count && buffers; ++i)
+    length += buffers[i].iov_len;
+  if (count < 0 || (count > 0 && !buffers) || length > std::numeric_limits<uint32_t>::max()) {
+    LOG(kError) << "Invalid scatter-gather list of " << count << " buffers, " << length
+                << " bytes.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  return static_cast<uint32_t>(length);
+}
+#endif
+
+}  // unnamed namespace
+
 SelfEncryptor::SelfEncryptor(DataMap& data_map, DataBuffer<std::string>& buffer,
                              std::function<NonEmptyString(const std::string&)> get_from_store)
     : data_map_(data_map),
-      kOriginalDataMap_(data_map),
-      sequencer_(kMaxChunkSize * 3),  // space for  min first 3 chunks
-      chunks_(),
+      journal_(data_map),
+      sequencer_(new Sequencer),
+      chunks_(new ChunkStatusTable<ChunkStatus>(ChunkStatus::none)),
       buffer_(buffer),
       get_from_store_(get_from_store),
       file_size_(data_map.size()),
       closed_(false),
-      data_mutex_() {
+      mutex_(),
+      fetched_(),
+      range_locks_(new ChunkRangeLocks),
+      data_mutex_(),
+      stats_(new StatsCounters),
+      charge_mutex_(),
+      sequencer_charge_(0),
+      tracer_(nullptr) {
   if (!get_from_store) {
     LOG(kError) << "Need to have a non-null get_from_store functor.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  auto pos(0);
+  sequencer_->Resize(file_size_);
+  uint32_t pos(0);
   if (!data_map_.chunks.empty()) {
     assert(data_map_.chunks.size() >= 3);
+    chunks_->Resize(static_cast<uint32_t>(data_map_.chunks.size()));
     for (uint32_t i(0); i < data_map_.chunks.size(); ++i)
-      chunks_.insert(std::make_pair(i, ChunkStatus::remote));
+      chunks_->Set(i, ChunkStatus::remote);
     for (uint32_t i(0); i < data_map_.chunks.size(); ++i) {
       if (i < 3) {  // just populate first three chunks
         ByteVector temp(DecryptChunk(i));
-        for (const auto& t : temp)
-          sequencer_[pos++] = t;
+        MemoryCharge charge(*stats_, temp.size());
+        sequencer_->Write(temp.data(), temp.size(), pos);
+        pos += static_cast<uint32_t>(temp.size());
+        chunks_->Set(i, ChunkStatus::stored);
       }
     }
   } else if (data_map_.content.size() > 0) {
-    for (const auto& t : data_map_.content)
-      sequencer_[pos++] = t;
-    chunks_.insert(std::make_pair(0, ChunkStatus::stored));
+    sequencer_->Write(data_map_.content.data(), data_map_.content.size(), 0);
+    chunks_->Set(0, ChunkStatus::stored);
   }
+  ChargeSequencer();
+}
+
+SelfEncryptor::~SelfEncryptor() {
+  assert(closed_ && "file not closed");
+  stats_->ReleaseMemory(sequencer_charge_);
 }
 
-SelfEncryptor::~SelfEncryptor() { assert(closed_ && "file not closed"); }
+SelfEncryptorStats SelfEncryptor::stats() const { return stats_->Snapshot(); }
+
+DataMap SelfEncryptor::original_data_map() const {
+  DataMap original(data_map_);
+  journal_.Restore(original);
+  return original;
+}
 
 bool SelfEncryptor::Write(const char* data, uint32_t length, uint64_t position) {
-  if (closed_)
-    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
-  on_scope_exit ose([this] { CleanUpAfterException(); });
-  SCOPED_PROFILE
+  return WriteRange(length, position, [&] {
+    sequencer_->Write(reinterpret_cast<const byte*>(data), length, position);
+  });
+}
 
-  file_size_ = std::max(file_size_, length + position);
-  PrepareWindow(length, position, true);
-  for (uint32_t i(0); i < length; ++i)
-    sequencer_[position + i] = data[i];  // direct as may be overwrite
-  ose.Release();
-  return true;
+bool SelfEncryptor::Write(ByteVector&& data, uint64_t position) {
+  if (data.size() > std::numeric_limits<uint32_t>::max()) {
+    LOG(kError) << "Can't write " << data.size() << " bytes in one call.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  uint32_t length(static_cast<uint32_t>(data.size()));
+  return WriteRange(length, position, [&] {
+    if (!sequencer_->Adopt(data, position))
+      sequencer_->Write(data.data(), length, position);
+    ByteVector().swap(data);
+  });
+}
+
+#ifndef WIN32
+bool SelfEncryptor::Write(const iovec* buffers, int count, uint64_t position) {
+  uint32_t length(TotalLength(buffers, count));
+  return WriteRange(length, position, [&] {
+    uint64_t buffer_position(position);
+    for (int i(0); i < count; ++i) {
+      sequencer_->Write(static_cast<const byte*>(buffers[i].iov_base), buffers[i].iov_len,
+                        buffer_position);
+      buffer_position += buffers[i].iov_len;
+    }
+  });
 }
+#endif
 
 bool SelfEncryptor::Read(char* data, uint32_t length, uint64_t position) {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   if (closed_)
     BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
   if ((position + length) > file_size_)
@@ -115,169 +184,436 @@ bool SelfEncryptor::Read(char* data, uint32_t length, uint64_t position) {
                    // zero if reading past EOF. Seems if a file is writtem past EOF then this shoudl
                    // be OK, this object follows the pattern that a write past EOF is fine, any read
                    // within that file will work, even on sparse files
-  on_scope_exit ose([this] { CleanUpAfterException(); });
   SCOPED_PROFILE
-  PrepareWindow(length, position, false);
-  for (uint32_t i(0); i < length; ++i)
-    data[i] = sequencer_[position + i];
-  ose.Release();
+  if (!PrepareReadWindow(length, position, lock))
+    return false;
+  ChunkRangeLocks::Guard range(*range_locks_, GetChunkNumber(position),
+                               GetChunkNumber(position + length) + 1, false);
+  sequencer_->Read(reinterpret_cast<byte*>(data), length, position);
+  stats_->Add(StatsCounters::kBytesRead, length);
   return true;
 }
 
+#ifndef WIN32
+bool SelfEncryptor::Read(const iovec* buffers, int count, uint64_t position) {
+  uint32_t length(TotalLength(buffers, count));
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
+  if (closed_)
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
+  if ((position + length) > file_size_)
+    return false;  // As for the single-buffer Read
+  SCOPED_PROFILE
+  if (!PrepareReadWindow(length, position, lock))
+    return false;
+  ChunkRangeLocks::Guard range(*range_locks_, GetChunkNumber(position),
+                               GetChunkNumber(position + length) + 1, false);
+  for (int i(0); i < count; ++i) {
+    sequencer_->Read(static_cast<byte*>(buffers[i].iov_base), buffers[i].iov_len, position);
+    position += buffers[i].iov_len;
+  }
+  stats_->Add(StatsCounters::kBytesRead, length);
+  return true;
+}
+#endif
+
 bool SelfEncryptor::Truncate(uint64_t position) {
+  boost::unique_lock<boost::shared_mutex> lock(mutex_);
   if (closed_)
     BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
   on_scope_exit ose([this] { CleanUpAfterException(); });
   SCOPED_PROFILE
 
-  auto old_size = file_size_;
-  file_size_ = position;  //  All helper methods calculate from file size
-  if (position < old_size) {
-    auto it(std::begin(chunks_));
-    while (it != std::end(chunks_))
-      if (it->first > position)
-        it = chunks_.erase(it);
-      else
-        ++it;
+  if (position < file_size_) {
+    PrepareResize(position);
+    file_size_ = position;  //  All helper methods calculate from file size
+    if (position + 1 < chunks_->size())
+      chunks_->Resize(static_cast<uint32_t>(position + 1));
+    // Dropping the cut-off data means truncating up again reads back zeros.
+    sequencer_->Resize(position);
+    ChargeSequencer();
   } else {
-    assert(position - old_size < std::numeric_limits<size_t>::max());
-    PrepareWindow(static_cast<uint32_t>(position - old_size), old_size, true);
+    ExtendTo(position);
   }
   ose.Release();
   return true;
 }
 
+void SelfEncryptor::Reserve(uint64_t expected_size) {
+  boost::unique_lock<boost::shared_mutex> lock(mutex_);
+  if (closed_)
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
+  sequencer_->Reserve(expected_size);
+  chunks_->Reserve(static_cast<uint32_t>(
+      std::max<uint64_t>(3, (expected_size + kMaxChunkSize - 1) / kMaxChunkSize)));
+}
+
 bool SelfEncryptor::Flush() {
+  boost::shared_lock<boost::shared_mutex> lock(mutex_);
   if (closed_)
     BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
   return true;
 }  // noop until we can tell if this is required when asked
 
 void SelfEncryptor::Close() {
+  boost::unique_lock<boost::shared_mutex> lock(mutex_);
   if (closed_)
     return;  // can call close multiple times, safely
   on_scope_exit ose([this] { CleanUpAfterException(); });
   SCOPED_PROFILE
+  TraceSpan span(tracer_, "Close");
 
   if (file_size_ < (3 * kMinChunkSize)) {
-    data_map_.content.clear();
-    data_map_.content.reserve(file_size_);
-    std::copy_n(std::begin(sequencer_), file_size_, std::back_inserter(data_map_.content));
+    // The content replaces any chunks the file had, and with them any Merkle root.
+    for (uint32_t i(0); i < data_map_.chunks.size(); ++i)
+      JournalChunk(i);
+    data_map_.chunks.clear();
+    data_map_.merkle_root.clear();
+    data_map_.content.resize(file_size_);
+    sequencer_->Read(data_map_.content.data(), file_size_, 0);
     ose.Release();
     closed_ = true;
     return;
   }
   assert(GetNumChunks() > 2 && "Try to close with less than 3 chunks");
+  data_map_.content.clear();  // Left from when the file was small
+  for (size_t i(GetNumChunks()); i < data_map_.chunks.size(); ++i)
+    JournalChunk(static_cast<uint32_t>(i));
   data_map_.chunks.resize(GetNumChunks());
+  // Every all-zero chunk has the same pre-hash.  Those lying in a hole are known to be zero without
+  // reading anything, so are done here rather than in a task of their own.
+  ByteVector zero_pre_hash(crypto::SHA512::DIGESTSIZE);
+  {
+    const byte kZeros[crypto::SHA512::DIGESTSIZE] = {};
+    CryptoPP::SHA512().CalculateDigest(&zero_pre_hash[0], kZeros, crypto::SHA512::DIGESTSIZE);
+  }
+  std::vector<char> zero_chunks(GetNumChunks(), 0);
+  // Statuses of chunks past the end, left by truncating, are ignored.
+  const uint32_t kNumChunks(std::min(chunks_->size(), GetNumChunks()));
+  // Each chunk is encrypted using the pre-hashes of the two before it, so the two after any chunk
+  // being rehashed must be encrypted again.  Writes' windows cover this within the file, but not
+  // the wrap from the last two chunks round to the first two, which are always in memory.
+  const uint32_t kLast(GetNumChunks() - 1);
+  uint32_t wrapped(chunks_->Get(kLast) == ChunkStatus::to_be_hashed
+                       ? 2
+                       : (chunks_->Get(kLast - 1) == ChunkStatus::to_be_hashed ? 1 : 0));
+  for (uint32_t chunk(0); chunk != wrapped; ++chunk) {
+    assert(chunks_->Get(chunk) != ChunkStatus::remote && "first chunks not read in");
+    if (chunks_->Get(chunk) == ChunkStatus::stored)
+      chunks_->Set(chunk, ChunkStatus::to_be_hashed);
+  }
   std::vector<std::future<void>> fut;
-  for (auto& chunk : chunks_) {
-    if (chunk.second == ChunkStatus::to_be_hashed ||
-        data_map_.chunks[chunk.first].pre_hash.empty() || GetNumChunks() == 3) {
-      auto this_size(GetChunkSize(chunk.first));
-      auto pos = GetStartEndPositions(chunk.first);
-
-      fut.emplace_back(std::async([=]() {
-        ByteVector tmp(this_size);
-        for (uint32_t i(0); i < this_size; ++i)
-          tmp[i] = sequencer_[i + pos.first];
-        assert(tmp.size() == this_size && "vector diff size from chunk size");
+  for (uint32_t chunk(0); chunk < kNumChunks; ++chunk) {
+    ChunkStatus status(chunks_->Get(chunk));
+    if (status == ChunkStatus::none)
+      continue;
+    if (status == ChunkStatus::to_be_hashed || data_map_.chunks[chunk].pre_hash.empty() ||
+        GetNumChunks() == 3) {
+      auto this_size(GetChunkSize(chunk));
+      auto pos = GetStartEndPositions(chunk);
+      chunks_->Set(chunk, ChunkStatus::to_be_encrypted);
+      JournalChunk(chunk);
+      if (sequencer_->IsHole(pos.first, this_size)) {
+        zero_chunks[chunk] = 1;
+        std::lock_guard<std::mutex> guard(data_mutex_);
+        data_map_.chunks[chunk].pre_hash = zero_pre_hash;
+        continue;
+      }
+
+      fut.emplace_back(std::async([=, &zero_pre_hash, &zero_chunks]() {
+        TraceSpan span(tracer_, "HashChunk", chunk);
         {
           std::lock_guard<std::mutex> guard(data_mutex_);
-          data_map_.chunks[chunk.first].pre_hash.clear();
-          data_map_.chunks[chunk.first].pre_hash.resize(crypto::SHA512::DIGESTSIZE);
+          data_map_.chunks[chunk].pre_hash.clear();
+          data_map_.chunks[chunk].pre_hash.resize(crypto::SHA512::DIGESTSIZE);
         }
         ByteVector tmp2(crypto::SHA512::DIGESTSIZE);
-        CryptoPP::SHA512().CalculateDigest(&tmp2.data()[0], &tmp.data()[0],
-                                           crypto::SHA512::DIGESTSIZE);
+        {
+          StageTimer timer(*stats_, StatsCounters::kHashTime);
+          if (sequencer_->IsZero(pos.first, this_size)) {
+            zero_chunks[chunk] = 1;
+            tmp2 = zero_pre_hash;
+          } else {
+            ByteVector scratch;
+            CryptoPP::SHA512().CalculateDigest(
+                &tmp2.data()[0], sequencer_->View(pos.first, crypto::SHA512::DIGESTSIZE, scratch),
+                crypto::SHA512::DIGESTSIZE);
+          }
+        }
         {
           std::lock_guard<std::mutex> guard(data_mutex_);
-          std::swap(data_map_.chunks[chunk.first].pre_hash, tmp2);
-          assert(crypto::SHA512::DIGESTSIZE == data_map_.chunks[chunk.first].pre_hash.size() &&
+          std::swap(data_map_.chunks[chunk].pre_hash, tmp2);
+          assert(crypto::SHA512::DIGESTSIZE == data_map_.chunks[chunk].pre_hash.size() &&
                  "Hash size wrong");
         }
       }));
-      chunk.second = ChunkStatus::to_be_encrypted;
     }
   }
   // thread barrier emulation
   for (auto& res : fut)
     res.wait();
+  // All-zero chunks of the same size whose n-1 and n-2 pre-hashes match encrypt to the same chunk,
+  // so only the first of each is encrypted and the rest are given its name.
+  std::map<std::pair<uint32_t, ByteVector>, uint32_t> zero_chunk_sources;
+  std::vector<std::pair<uint32_t, uint32_t>> zero_chunk_copies;
   std::vector<std::future<void>> fut2;
-  for (auto& chunk : chunks_) {
-    if (chunk.second == ChunkStatus::to_be_encrypted) {
-      auto this_size(GetChunkSize(chunk.first));
-      auto pos = GetStartEndPositions(chunk.first);
+  for (uint32_t chunk(0); chunk < kNumChunks; ++chunk) {
+    if (chunks_->Get(chunk) == ChunkStatus::to_be_encrypted) {
+      auto this_size(GetChunkSize(chunk));
+      auto pos = GetStartEndPositions(chunk);
+      chunks_->Set(chunk, ChunkStatus::stored);
+      if (zero_chunks[chunk]) {
+        uint32_t n_1_chunk(GetPreviousChunkNumber(chunk));
+        ByteVector neighbours(data_map_.chunks[n_1_chunk].pre_hash);
+        const ByteVector& n_2_pre_hash(
+            data_map_.chunks[GetPreviousChunkNumber(n_1_chunk)].pre_hash);
+        neighbours.insert(std::end(neighbours), std::begin(n_2_pre_hash), std::end(n_2_pre_hash));
+        auto source(zero_chunk_sources.insert(
+            std::make_pair(std::make_pair(this_size, std::move(neighbours)), chunk)));
+        if (!source.second) {
+          zero_chunk_copies.emplace_back(chunk, source.first->second);
+          continue;
+        }
+      }
 
+      // sequencer_ isn't changed during Close, so chunks within one segment are encrypted straight
+      // from it.
       fut2.emplace_back(std::async([=]() {
-        ByteVector tmp(this_size);
-        for (uint32_t i(0); i < this_size; ++i)
-          tmp[i] = sequencer_[i + pos.first];
-        EncryptChunk(chunk.first, tmp, this_size);
+        ByteVector scratch;
+        const byte* data(sequencer_->View(pos.first, this_size, scratch));
+        MemoryCharge charge(*stats_, scratch.capacity());
+        EncryptChunk(chunk, data, this_size);
       }));
-      chunk.second = ChunkStatus::stored;
     }
   }
   // thread barrier emulation
   for (auto& res : fut2)
     res.wait();
+  for (const auto& copy : zero_chunk_copies) {
+    const ChunkDetails& source(data_map_.chunks[copy.second]);
+    data_map_.chunks[copy.first].hash = source.hash;
+    data_map_.chunks[copy.first].size = source.size;
+    data_map_.chunks[copy.first].storage_state = source.storage_state;
+  }
+  stats_->Add(StatsCounters::kZeroChunksReused, zero_chunk_copies.size());
+  if (!data_map_.merkle_root.empty())
+    data_map_.merkle_root = MerkleTree(data_map_).root();
   ose.Release();
   closed_ = true;
 }
 
 // ##############################Private######################
 
-void SelfEncryptor::PrepareWindow(uint32_t length, uint64_t position, bool write) {
-  if (sequencer_.size() < file_size_) {
-    sequencer_.resize(file_size_);
-    assert(sequencer_.size() == file_size_);
+template <typename CopyIn>
+bool SelfEncryptor::WriteRange(uint32_t length, uint64_t position, CopyIn copy_in) {
+  SCOPED_PROFILE
+  {
+    // A Write which neither grows the file nor reaches its last two chunks changes nothing but the
+    // data and statuses of the chunks in its window, so only those are locked.  Anything else in
+    // the encryptor it touches is atomic.
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    if (closed_)
+      BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
+    if (file_size_ >= 3 * kMaxChunkSize && position + length <= file_size_) {
+      auto window(GetWindow(length, position));
+      if (window.second + 2 <= GetNumChunks() && window.second <= chunks_->size()) {
+        ChunkRangeLocks::Guard range(*range_locks_, window.first, window.second, true);
+        PrepareWindow(length, position, true);
+        copy_in();
+        ChargeSequencer();
+        stats_->Add(StatsCounters::kBytesWritten, length);
+        return true;
+      }
+    }
   }
+
+  boost::unique_lock<boost::shared_mutex> lock(mutex_);
+  if (closed_)
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
+  on_scope_exit ose([this] { CleanUpAfterException(); });
+  if (position + length > file_size_)
+    ExtendTo(position + length);
+  PrepareWindow(length, position, true);
+  copy_in();
+  ChargeSequencer();
+  stats_->Add(StatsCounters::kBytesWritten, length);
+  ose.Release();
+  return true;
+}
+
+std::pair<uint32_t, uint32_t> SelfEncryptor::GetWindow(uint64_t length, uint64_t position) const {
+  // Chunk n is encrypted using the pre-hashes of chunks n - 1 and n - 2, so the window runs to two
+  // chunks past the last one the range touches, where the file has them.
+  uint32_t first_chunk(GetChunkNumber(position));
+  uint32_t last_chunk(GetChunkNumber(length == 0 ? position : position + length - 1));
+  return std::make_pair(first_chunk, std::min(last_chunk + 3, GetNumChunks()));
+}
+
+void SelfEncryptor::PrepareWindow(uint64_t length, uint64_t position, bool overwrite) {
+  TraceSpan span(tracer_, "PrepareWindow", GetChunkNumber(position));
+  // Growing only extends the hole at the end, so costs no memory.
+  if (sequencer_->size() < file_size_)
+    sequencer_->Resize(file_size_);
   if (file_size_ < (3 * kMinChunkSize))
     return;
-  auto first_chunk(GetChunkNumber(position));
-  auto last_chunk(GetChunkNumber(position + length));
-  if (write && (sequencer_.size() < (position + length))) {
-    sequencer_.resize(position + length);
-    assert(sequencer_.size() == (position + length) && "could not resize sequencer");
-  }
-  if (file_size_ < 3 * kMaxChunkSize) {
-    first_chunk = 0;  // in this case encrypt all.
-    last_chunk = 3;
-    chunks_.clear();  // make sure to mark all correctly
-  } else {            // do not read ahead unless possible
-    for (auto i(1); i < 3; ++i)
-      if (last_chunk < GetNumChunks())
-        ++last_chunk;
-  }
+  if (sequencer_->size() < (position + length))
+    sequencer_->Resize(position + length);
+  uint32_t first_chunk(0), last_chunk(3);  // if the file's this small, encrypt all.
+  if (file_size_ < 3 * kMaxChunkSize)
+    chunks_->Clear();  // make sure to mark all correctly
+  else
+    std::tie(first_chunk, last_chunk) = GetWindow(length, position);
 
-  std::vector<std::future<void>> fut2;
+  // All statuses are settled before any fetch starts, so the fetches don't race with the table
+  // growing.
+  std::vector<uint32_t> to_fetch;
   for (auto i(first_chunk); i < last_chunk; ++i) {
-    auto current_chunk_itr = chunks_.find(i);
-    if (current_chunk_itr == std::end(chunks_)) {
-      write ? chunks_.insert({i, ChunkStatus::to_be_hashed})
-            : chunks_.insert({i, ChunkStatus::stored});
+    ChunkStatus status(chunks_->Get(i));
+    if (status == ChunkStatus::none) {
+      chunks_->Set(i, ChunkStatus::to_be_hashed);
+    } else if (status == ChunkStatus::remote || status == ChunkStatus::fetching) {
+      // A reader still fetching the chunk will find it taken over, and drop its copy.
+      // A remote chunk whose every byte is about to be replaced needn't be fetched.  Its old data
+      // would land at the chunk's current start position, so that's the range checked.
+      uint64_t start(GetStartEndPositions(i).first);
+      uint64_t end(start + std::max(GetChunkSize(i), data_map_.chunks[i].size));
+      if (overwrite && position <= start && end <= position + length)
+        stats_->Add(StatsCounters::kFetchesSkipped, 1);
+      else
+        to_fetch.push_back(i);
+      chunks_->Set(i, ChunkStatus::to_be_hashed);
     } else {
-      auto pos(GetStartEndPositions(i).first);
-      if (current_chunk_itr->second == ChunkStatus::remote) {
-        fut2.emplace_back(std::async([=]() {
-          auto ins = pos;
-          ByteVector tmp(DecryptChunk(i));
-          for (const auto& t : tmp)
-            sequencer_[ins++] = t;
-        }));
-        write ? current_chunk_itr->second = ChunkStatus::to_be_hashed : current_chunk_itr->second =
-                                                                            ChunkStatus::stored;
-      } else {
-        current_chunk_itr->second = ChunkStatus::to_be_hashed;
-      }
+      stats_->Add(StatsCounters::kCacheHits, 1);
+      chunks_->Set(i, ChunkStatus::to_be_hashed);
     }
   }
+
+  // Segments are allocated before any fetch starts, since neighbouring chunks can share one.
+  for (auto i : to_fetch)
+    sequencer_->Allocate(GetStartEndPositions(i).first, data_map_.chunks[i].size);
+  ChargeSequencer();
+  std::vector<std::future<void>> fut2;
+  for (auto i : to_fetch) {
+    auto pos(GetStartEndPositions(i).first);
+    fut2.emplace_back(std::async([=]() {
+      ByteVector tmp(DecryptChunk(i));
+      MemoryCharge charge(*stats_, tmp.size());
+      sequencer_->Write(tmp.data(), tmp.size(), pos);
+    }));
+  }
   // thread barrier emulation
   for (auto& res : fut2)
     res.wait();
 }
 
+bool SelfEncryptor::PrepareReadWindow(uint64_t length, uint64_t position,
+                                      boost::shared_lock<boost::shared_mutex>& lock) {
+  TraceSpan span(tracer_, "PrepareWindow", GetChunkNumber(position));
+  // Files this small are wholly in memory from when they're opened.
+  if (file_size_ < 3 * kMaxChunkSize)
+    return true;
+  uint32_t first_chunk, last_chunk;
+  std::tie(first_chunk, last_chunk) = GetWindow(length, position);
+
+  // Each remote chunk is claimed by exactly one reader, which fetches it; any other reader needing
+  // it waits for that fetch rather than making its own.
+  std::vector<uint32_t> to_fetch, to_await;
+  for (auto i(first_chunk); i < last_chunk; ++i) {
+    ChunkStatus status(ChunkStatus::remote);
+    if (chunks_->CompareExchange(i, status, ChunkStatus::fetching))
+      to_fetch.push_back(i);
+    else if (status == ChunkStatus::fetching)
+      to_await.push_back(i);
+    else if (status != ChunkStatus::none)
+      stats_->Add(StatsCounters::kCacheHits, 1);
+  }
+  if (to_fetch.empty() && to_await.empty())
+    return true;
+
+  if (!to_fetch.empty()) {
+    // data_map_ is only changed under an exclusive lock, so is safe to decrypt from under this one.
+    std::vector<std::future<ByteVector>> fetches;
+    for (auto i : to_fetch)
+      fetches.emplace_back(std::async([=] { return DecryptChunk(i); }));
+    std::vector<std::pair<uint32_t, ByteVector>> fetched;
+    for (size_t i(0); i < fetches.size(); ++i) {
+      try {
+        fetched.emplace_back(to_fetch[i], fetches[i].get());
+      }
+      catch (const std::exception& e) {
+        LOG(kWarning) << "Failed to fetch chunk " << to_fetch[i] << ": "
+                      << boost::diagnostic_information(e);
+      }
+    }
+    lock.unlock();
+    {
+      boost::unique_lock<boost::shared_mutex> exclusive(mutex_);
+      for (auto& chunk : fetched) {
+        // A writer may have taken the chunk over, or cut it off, while this lock was released.
+        uint64_t pos(GetStartEndPositions(chunk.first).first);
+        if (closed_ || chunks_->Get(chunk.first) != ChunkStatus::fetching || pos >= file_size_)
+          continue;
+        sequencer_->Write(chunk.second.data(),
+                          std::min<uint64_t>(chunk.second.size(), file_size_ - pos), pos);
+        chunks_->Set(chunk.first, ChunkStatus::stored);
+      }
+      // Chunks which failed are left for the next read to retry.
+      for (auto i : to_fetch) {
+        if (chunks_->Get(i) == ChunkStatus::fetching)
+          chunks_->Set(i, ChunkStatus::remote);
+      }
+      ChargeSequencer();
+    }
+    fetched_.notify_all();
+    lock.lock();
+  }
+  fetched_.wait(lock, [&] {
+    return std::none_of(std::begin(to_await), std::end(to_await), [this](uint32_t chunk) {
+      return chunks_->Get(chunk) == ChunkStatus::fetching;
+    });
+  });
+
+  if (closed_)
+    BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::encryptor_closed));
+  if ((position + length) > file_size_)
+    return false;
+  for (auto i(first_chunk); i < last_chunk && GetStartEndPositions(i).first < position + length;
+       ++i) {
+    ChunkStatus status(chunks_->Get(i));
+    if (status == ChunkStatus::remote || status == ChunkStatus::fetching) {
+      LOG(kWarning) << "Can't read chunk " << i << " of " << GetNumChunks();
+      return false;
+    }
+  }
+  return true;
+}
+
+void SelfEncryptor::ExtendTo(uint64_t size) {
+  PrepareResize(size);
+  // Only the chunks around the old end hold data; the rest of the window is a hole.
+  uint64_t old_size(file_size_);
+  file_size_ = size;
+  PrepareWindow(size - old_size, old_size);
+}
+
+void SelfEncryptor::PrepareResize(uint64_t size) {
+  if (GetNumChunks() == 0)
+    return;
+  // A small file's chunks are all read in on opening, so only the last two can still be remote.
+  uint32_t first_chunk(GetNumChunks() - 2);
+  uint64_t end(file_size_);
+  if (size < file_size_) {
+    // The chunks which will become the last two change shape too.
+    first_chunk = std::min(first_chunk,
+                           GetChunkNumber(size > 2 * kMaxChunkSize ? size - 2 * kMaxChunkSize : 0));
+    end = size;
+  }
+  uint64_t start(GetStartEndPositions(first_chunk).first);
+  PrepareWindow(end - start, start);
+}
+
 ByteVector SelfEncryptor::DecryptChunk(uint32_t chunk_num) {
   SCOPED_PROFILE
+  TraceSpan span(tracer_, "DecryptChunk", chunk_num);
   if (data_map_.chunks.size() < chunk_num) {
     LOG(kWarning) << "Can't decrypt chunk " << chunk_num << " of " << data_map_.chunks.size();
     BOOST_THROW_EXCEPTION(MakeError(EncryptErrors::failed_to_decrypt));
@@ -285,6 +621,7 @@ ByteVector SelfEncryptor::DecryptChunk(uint32_t chunk_num) {
 
   uint32_t length = data_map_.chunks[chunk_num].size;
   ByteVector data(length);
+  MemoryCharge data_charge(*stats_, length);
   ByteVector pad(kPadSize);
   ByteVector key(crypto::AES256_KeySize);
   ByteVector iv(crypto::AES256_IVSize);
@@ -294,6 +631,8 @@ ByteVector SelfEncryptor::DecryptChunk(uint32_t chunk_num) {
   assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
   NonEmptyString content;
   try {
+    StageTimer timer(*stats_, StatsCounters::kFetchTime);
+    TraceSpan fetch_span(tracer_, "Fetch", chunk_num);
     content = get_from_store_(std::string(std::begin(data_map_.chunks[chunk_num].hash),
                                           std::end(data_map_.chunks[chunk_num].hash)));
   }
@@ -301,18 +640,13 @@ ByteVector SelfEncryptor::DecryptChunk(uint32_t chunk_num) {
     LOG(kInfo) << boost::diagnostic_information(e);
     throw;
   }
-  // asserts on vector sizes
-  CryptoPP::CFB_Mode<CryptoPP::AES>::Decryption decryptor(&key.data()[0], crypto::AES256_KeySize,
-                                                          &iv.data()[0]);
-  CryptoPP::StringSource filter(
-      content.string(), true,
-      new XORFilter(new CryptoPP::StreamTransformationFilter(
-                        decryptor, new CryptoPP::Gunzip(new CryptoPP::MessageQueue)),
-                    &pad.data()[0]));
-  filter.Get(&data.data()[0], length);
-  auto chunk_itr(chunks_.find(chunk_num));
-  assert(chunk_itr != std::end(chunks_) && "chunks status not found");
-  chunk_itr->second = ChunkStatus::stored;
+  stats_->Add(StatsCounters::kChunksFetched, 1);
+  MemoryCharge content_charge(*stats_, content.string().size());
+  {
+    StageTimer timer(*stats_, StatsCounters::kDecryptTime);
+    DecryptChunkContent(content.string(), key, iv, pad, &data.data()[0], length);
+  }
+  stats_->Add(StatsCounters::kChunksDecrypted, 1);
 
   return data;
 }
@@ -325,60 +659,30 @@ void SelfEncryptor::GetPadIvKey(uint32_t chunk_number, ByteVector& key, ByteVect
   assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
   uint32_t n_1_chunk(GetPreviousChunkNumber(chunk_number));
   uint32_t n_2_chunk(GetPreviousChunkNumber(n_1_chunk));
-#ifndef NDEBUG
-  auto chunk_n_1_itr(chunks_.find(n_1_chunk));
-  auto chunk_n_2_itr(chunks_.find(n_2_chunk));
-#endif
-  assert(chunks_.size() >= n_1_chunk);
-  assert(chunks_.size() >= n_2_chunk);
-  assert(chunk_n_1_itr != std::end(chunks_) && "chunk_n_1 chunkstatus not found");
-  assert(chunk_n_2_itr != std::end(chunks_) && "chunk_n_2 chunkstatus not found");
-
-  const ByteVector n_1_pre_hash{data_map_.chunks[n_1_chunk].pre_hash};
-  const ByteVector n_2_pre_hash{data_map_.chunks[n_2_chunk].pre_hash};
-
-  assert(n_1_pre_hash.size() == crypto::SHA512::DIGESTSIZE);
-  assert(n_2_pre_hash.size() == crypto::SHA512::DIGESTSIZE);
-  key.clear();
-  // cannot use copy_n as there is an apparent bug in MSVC 2013 :-(
-  std::copy(std::begin(n_2_pre_hash), std::begin(n_2_pre_hash) + crypto::AES256_KeySize,
-            std::back_inserter(key));
-  iv.clear();
-  std::copy(std::begin(n_2_pre_hash) + crypto::AES256_KeySize,
-            std::begin(n_2_pre_hash) + crypto::AES256_KeySize + crypto::AES256_IVSize,
-            std::back_inserter(iv));
-  // pad
-  assert(kPadSize == (2 * crypto::SHA512::DIGESTSIZE) + crypto::SHA512::DIGESTSIZE -
-                         crypto::AES256_KeySize - crypto::AES256_IVSize &&
-         "pad size wrong");
-  pad.clear();
-  std::copy_n(std::begin(n_1_pre_hash), crypto::SHA512::DIGESTSIZE, std::back_inserter(pad));
-  std::copy_n(std::begin(data_map_.chunks[chunk_number].pre_hash), crypto::SHA512::DIGESTSIZE,
-              std::back_inserter(pad));  // + crypto::SHA512::DIGESTSIZE);
-  std::copy_n(std::begin(n_2_pre_hash) + crypto::AES256_KeySize + crypto::AES256_IVSize,
-              crypto::SHA512::DIGESTSIZE - crypto::AES256_KeySize - crypto::AES256_IVSize,
-              std::back_inserter(pad));  // + crypto::SHA512::DIGESTSIZE * 2);
-  assert(pad.size() == kPadSize && "pad size incorrect");
-  assert(key.size() == crypto::AES256_KeySize && "key size incorrect");
-  assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
+  assert(chunks_->size() >= n_1_chunk);
+  assert(chunks_->size() >= n_2_chunk);
+  assert(chunks_->Get(n_1_chunk) != ChunkStatus::none && "chunk_n_1 chunkstatus not found");
+  assert(chunks_->Get(n_2_chunk) != ChunkStatus::none && "chunk_n_2 chunkstatus not found");
+
+  encrypt::GetPadIvKey(data_map_.chunks[chunk_number].pre_hash,
+                       data_map_.chunks[n_1_chunk].pre_hash, data_map_.chunks[n_2_chunk].pre_hash,
+                       key, iv, pad);
 }
 
-void SelfEncryptor::EncryptChunk(uint32_t chunk_number, ByteVector data, uint32_t length) {
+void SelfEncryptor::EncryptChunk(uint32_t chunk_number, const byte* data, uint32_t length) {
   SCOPED_PROFILE
-  auto chunk_n_itr(chunks_.find(chunk_number));
-  assert(chunk_n_itr != std::end(chunks_) && "this chunk chunkstatus not found");
+  TraceSpan span(tracer_, "EncryptChunk", chunk_number);
+  assert(chunks_->Get(chunk_number) != ChunkStatus::none && "this chunk chunkstatus not found");
 #ifndef NDEBUG
   {
   std::lock_guard<std::mutex> guard(data_mutex_);
   assert(data_map_.chunks.size() >= chunk_number);
-  assert(chunks_.size() >= chunk_number);
+  assert(chunks_->size() >= chunk_number);
   uint32_t n_1_chunk(GetPreviousChunkNumber(chunk_number));
   uint32_t n_2_chunk(GetPreviousChunkNumber(n_1_chunk));
-  auto chunk_n_1_itr(chunks_.find(n_1_chunk));
-  auto chunk_n_2_itr(chunks_.find(n_2_chunk));
 
-  assert(chunk_n_1_itr->second != ChunkStatus::to_be_hashed && "chunk_n_1 hash invalid");
-  assert(chunk_n_2_itr->second != ChunkStatus::to_be_hashed && "chunk_n_2 hash invalid");
+  assert(chunks_->Get(n_1_chunk) != ChunkStatus::to_be_hashed && "chunk_n_1 hash invalid");
+  assert(chunks_->Get(n_2_chunk) != ChunkStatus::to_be_hashed && "chunk_n_2 hash invalid");
   }
 #endif
 
@@ -390,34 +694,79 @@ void SelfEncryptor::EncryptChunk(uint32_t chunk_number, ByteVector data, uint32_
   assert(key.size() == crypto::AES256_KeySize && "key size incorrect");
   assert(iv.size() == crypto::AES256_IVSize && "iv size incorrect");
 
-  CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(&key.data()[0], crypto::AES256_KeySize,
-                                                          &iv.data()[0]);
-
   std::string chunk_content;
   chunk_content.reserve(length);
-  CryptoPP::Gzip aes_filter(
-      new CryptoPP::StreamTransformationFilter(
-          encryptor, new XORFilter(new CryptoPP::StringSink(chunk_content), &pad.data()[0])),
-      1);
-  aes_filter.Put2(&data.data()[0], length, -1, true);
+  MemoryCharge content_charge(*stats_, chunk_content.capacity());
+  {
+    StageTimer timer(*stats_, StatsCounters::kEncryptTime);
+    CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(
+        &key.data()[0], crypto::AES256_KeySize, &iv.data()[0]);
+    CryptoPP::Gzip aes_filter(
+        new CryptoPP::StreamTransformationFilter(
+            encryptor, new XORFilter(new CryptoPP::StringSink(chunk_content), &pad.data()[0])),
+        1);
+    aes_filter.Put2(data, length, -1, true);
+  }
+  stats_->Add(StatsCounters::kChunksEncrypted, 1);
 
-  CryptoPP::SHA512 hash;
   std::string result;
-  CryptoPP::StringSource(chunk_content, true,
-                         new CryptoPP::HashFilter(hash, new CryptoPP::StringSink(result)));
+  {
+    StageTimer timer(*stats_, StatsCounters::kHashTime);
+    CryptoPP::SHA512 hash;
+    CryptoPP::StringSource(chunk_content, true,
+                           new CryptoPP::HashFilter(hash, new CryptoPP::StringSink(result)));
+  }
 
-  buffer_.Store(result, NonEmptyString(chunk_content));
+  {
+    StageTimer timer(*stats_, StatsCounters::kStoreTime);
+    TraceSpan store_span(tracer_, "Store", chunk_number);
+    MemoryCharge copy_charge(*stats_, chunk_content.size());
+    buffer_.Store(result, NonEmptyString(chunk_content));
+  }
+  stats_->Add(StatsCounters::kChunksStored, 1);
   {
     std::lock_guard<std::mutex> guard(data_mutex_);
     ByteVector tmp2(std::begin(result), std::end(result));
     std::swap(data_map_.chunks[chunk_number].hash, tmp2);
-    chunk_n_itr->second = ChunkStatus::stored;
     assert(crypto::SHA512::DIGESTSIZE == data_map_.chunks[chunk_number].hash.size() &&
            "Hash size wrong");
 
     data_map_.chunks[chunk_number].size = length;  // keep pre-compressed length
     data_map_.chunks[chunk_number].storage_state = ChunkDetails::kPending;
   }
+  chunks_->Set(chunk_number, ChunkStatus::stored);
+}
+
+void SelfEncryptor::JournalChunk(uint32_t chunk_num) {
+  if (chunk_num < journal_.chunk_count && journal_.chunks.count(chunk_num) == 0)
+    journal_.chunks.insert(std::make_pair(chunk_num, data_map_.chunks[chunk_num]));
+}
+
+void SelfEncryptor::ChargeSequencer() {
+  std::lock_guard<std::mutex> guard(charge_mutex_);
+  uint64_t allocated(sequencer_->allocated_bytes());
+  if (allocated > sequencer_charge_)
+    stats_->AllocateMemory(allocated - sequencer_charge_);
+  else if (allocated < sequencer_charge_)
+    stats_->ReleaseMemory(sequencer_charge_ - allocated);
+  sequencer_charge_ = allocated;
+  stats_->RaiseTo(StatsCounters::kPeakSequencerBytes, allocated);
+}
+
+SelfEncryptor::DataMapJournal::DataMapJournal(const DataMap& data_map)
+    : self_encryption_version(data_map.self_encryption_version),
+      chunk_count(data_map.chunks.size()),
+      content(data_map.content),
+      merkle_root(data_map.merkle_root),
+      chunks() {}
+
+void SelfEncryptor::DataMapJournal::Restore(DataMap& data_map) const {
+  data_map.self_encryption_version = self_encryption_version;
+  data_map.chunks.resize(chunk_count);
+  for (const auto& chunk : chunks)
+    data_map.chunks[chunk.first] = chunk.second;
+  data_map.content = content;
+  data_map.merkle_root = merkle_root;
 }
 
 // ####################Helpers############################
@@ -471,17 +820,19 @@ std::pair<uint64_t, uint64_t> SelfEncryptor::GetStartEndPositions(uint32_t chunk
   assert(GetNumChunks() > 2 && "less than 3 chunks");
   if (GetNumChunks() == 0)
     return {0, 0};
-  auto start(0);
+  // Done in 64 bits, as chunks past 4 GiB start beyond the range of uint32_t.
+  const uint64_t kChunkSize(GetChunkSize(0));
+  uint64_t start(0);
   bool penultimate((GetNumChunks() - 2) == chunk_number);
   bool last((GetNumChunks() - 1) == chunk_number);
 
   if (last) {
-    start = ((GetChunkSize(0) * (chunk_number - 2)) + GetChunkSize(chunk_number - 2) +
+    start = ((kChunkSize * (chunk_number - 2)) + GetChunkSize(chunk_number - 2) +
              GetChunkSize(chunk_number - 1));
   } else if (penultimate) {
-    start = ((GetChunkSize(0) * (chunk_number - 1)) + GetChunkSize(chunk_number - 1));
+    start = ((kChunkSize * (chunk_number - 1)) + GetChunkSize(chunk_number - 1));
   } else {
-    start = (GetChunkSize(0) * (chunk_number));
+    start = (kChunkSize * chunk_number);
   }
 
   return std::make_pair(start, start + GetChunkSize(chunk_number));
@@ -0,0 +1,155 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/sequencer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+bool IsAllZero(const byte* data, uint64_t length) {
+  return length == 0 || (data[0] == 0 && std::memcmp(data, data + 1, length - 1) == 0);
+}
+
+}  // unnamed namespace
+
+void Sequencer::Resize(uint64_t size) {
+  uint64_t segment_count((size + kSegmentSize - 1) / kSegmentSize);
+  if (size < size_) {
+    for (uint64_t i(segment_count); i < segments_.size(); ++i)
+      allocated_bytes_ -= segments_[i].capacity();
+    segments_.resize(segment_count);
+    uint32_t tail(static_cast<uint32_t>(size % kSegmentSize));
+    if (tail != 0 && !segments_.back().empty())
+      std::fill(std::begin(segments_.back()) + tail, std::end(segments_.back()), 0);
+  } else {
+    segments_.resize(segment_count);
+  }
+  size_ = size;
+}
+
+void Sequencer::Reserve(uint64_t size) {
+  segments_.reserve(static_cast<size_t>((size + kSegmentSize - 1) / kSegmentSize));
+}
+
+void Sequencer::Write(const byte* data, uint64_t length, uint64_t position) {
+  if (position + length > size_)
+    Resize(position + length);
+  while (length != 0) {
+    uint64_t index(position / kSegmentSize);
+    uint32_t offset(static_cast<uint32_t>(position % kSegmentSize));
+    uint32_t piece(static_cast<uint32_t>(std::min<uint64_t>(length, kSegmentSize - offset)));
+    if (!segments_[index].empty() || !IsAllZero(data, piece))
+      std::memcpy(&AllocateSegment(index)[offset], data, piece);
+    data += piece;
+    position += piece;
+    length -= piece;
+  }
+}
+
+bool Sequencer::Adopt(ByteVector& data, uint64_t position) {
+  if (position % kSegmentSize != 0 || data.size() != kSegmentSize)
+    return false;
+  if (position + kSegmentSize > size_)
+    Resize(position + kSegmentSize);
+  ByteVector& segment(segments_[position / kSegmentSize]);
+  allocated_bytes_ -= segment.capacity();
+  segment.swap(data);
+  allocated_bytes_ += segment.capacity();
+  ByteVector().swap(data);
+  return true;
+}
+
+void Sequencer::Allocate(uint64_t position, uint64_t length) {
+  if (position + length > size_)
+    Resize(position + length);
+  if (length == 0)
+    return;
+  for (uint64_t i(position / kSegmentSize); i <= (position + length - 1) / kSegmentSize; ++i)
+    AllocateSegment(i);
+}
+
+void Sequencer::Read(byte* data, uint64_t length, uint64_t position) const {
+  assert(position + length <= size_);
+  while (length != 0) {
+    uint64_t index(position / kSegmentSize);
+    uint32_t offset(static_cast<uint32_t>(position % kSegmentSize));
+    uint32_t piece(static_cast<uint32_t>(std::min<uint64_t>(length, kSegmentSize - offset)));
+    if (segments_[index].empty())
+      std::memset(data, 0, piece);
+    else
+      std::memcpy(data, &segments_[index][offset], piece);
+    data += piece;
+    position += piece;
+    length -= piece;
+  }
+}
+
+bool Sequencer::IsHole(uint64_t position, uint64_t length) const {
+  if (length == 0)
+    return true;
+  for (uint64_t i(position / kSegmentSize); i <= (position + length - 1) / kSegmentSize; ++i) {
+    if (i < segments_.size() && !segments_[i].empty())
+      return false;
+  }
+  return true;
+}
+
+bool Sequencer::IsZero(uint64_t position, uint64_t length) const {
+  while (length != 0) {
+    uint64_t index(position / kSegmentSize);
+    uint32_t offset(static_cast<uint32_t>(position % kSegmentSize));
+    uint32_t piece(static_cast<uint32_t>(std::min<uint64_t>(length, kSegmentSize - offset)));
+    if (index < segments_.size() && !segments_[index].empty() &&
+        !IsAllZero(&segments_[index][offset], piece)) {
+      return false;
+    }
+    position += piece;
+    length -= piece;
+  }
+  return true;
+}
+
+const byte* Sequencer::View(uint64_t position, uint64_t length, ByteVector& scratch) const {
+  uint64_t index(position / kSegmentSize);
+  uint32_t offset(static_cast<uint32_t>(position % kSegmentSize));
+  if (length != 0 && offset + length <= kSegmentSize && !segments_[index].empty())
+    return &segments_[index][offset];
+  scratch.resize(length);
+  Read(scratch.data(), length, position);
+  return scratch.data();
+}
+
+ByteVector& Sequencer::AllocateSegment(uint64_t index) {
+  ByteVector& segment(segments_[index]);
+  if (segment.empty()) {
+    segment.resize(kSegmentSize);
+    allocated_bytes_ += segment.capacity();
+  }
+  return segment;
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
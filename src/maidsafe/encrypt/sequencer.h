@@ -0,0 +1,87 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_SEQUENCER_H_
+#define MAIDSAFE_ENCRYPT_SEQUENCER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/config.h"
+
+#include "maidsafe/encrypt/config.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// The plain text of a file, held in kSegmentSize segments which are only allocated once something
+// other than zeros is written to them.  Unallocated segments are holes and read back as zeros, so
+// a sparse file only costs memory for the parts of it which hold data.
+//
+// Writes and Adopts which don't grow the sequencer may run concurrently with each other and with
+// the const members, provided no two touch the same bytes, and none touches a segment another is
+// allocating.  Resize may not run concurrently with anything.
+class Sequencer {
+ public:
+  static const uint32_t kSegmentSize = kMaxChunkSize;
+
+  Sequencer() : segments_(), size_(0), allocated_bytes_(0) {}
+  Sequencer(const Sequencer&) = delete;
+  Sequencer& operator=(const Sequencer&) = delete;
+
+  uint64_t size() const { return size_; }
+  // Bytes held by allocated segments.
+  uint64_t allocated_bytes() const { return allocated_bytes_; }
+
+  // Growing leaves a hole; shrinking frees the segments past |size| and zeroes the tail of the new
+  // last segment, so growing again reads back zeros rather than the old data.
+  void Resize(uint64_t size);
+  // Makes room to index |size| bytes' worth of segments without allocating any of them, so growing
+  // to |size| never reallocates the index.  Allocated segments never move in any case.
+  void Reserve(uint64_t size);
+  // Grows the sequencer if needed.  Zeros written over a hole don't allocate anything.
+  void Write(const byte* data, uint64_t length, uint64_t position);
+  // If |data| exactly fills the segment starting at |position|, it is moved in as that segment's
+  // storage and true is returned.  Otherwise nothing is done.
+  bool Adopt(ByteVector& data, uint64_t position);
+  // Allocates every segment overlapping [position, position + length) ahead of concurrent Writes.
+  void Allocate(uint64_t position, uint64_t length);
+  void Read(byte* data, uint64_t length, uint64_t position) const;
+  // True if no segment overlapping the range is allocated.
+  bool IsHole(uint64_t position, uint64_t length) const;
+  // True if every byte of the range is zero.  Holes are skipped without being read.
+  bool IsZero(uint64_t position, uint64_t length) const;
+  // Returns the |length| bytes from |position| contiguously: in place if they lie within one
+  // allocated segment, otherwise gathered into |scratch|.
+  const byte* View(uint64_t position, uint64_t length, ByteVector& scratch) const;
+
+ private:
+  ByteVector& AllocateSegment(uint64_t index);
+
+  std::vector<ByteVector> segments_;  // An empty segment is a hole.
+  uint64_t size_;
+  std::atomic<uint64_t> allocated_bytes_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_SEQUENCER_H_
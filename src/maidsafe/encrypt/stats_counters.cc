@@ -0,0 +1,127 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/stats_counters.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace encrypt {
+
+void StatsCounters::Add(Counter counter, uint64_t value) {
+  AddLocal(counter, value);
+  if (this != &Process())
+    Process().AddLocal(counter, value);
+}
+
+void StatsCounters::RaiseTo(Counter counter, uint64_t value) {
+  RaiseLocal(counter, value);
+  if (this != &Process())
+    Process().RaiseLocal(counter, value);
+}
+
+void StatsCounters::AllocateMemory(uint64_t bytes) {
+  AllocateLocal(bytes);
+  if (this != &Process())
+    Process().AllocateLocal(bytes);
+}
+
+void StatsCounters::ReleaseMemory(uint64_t bytes) {
+  counters_[kMemoryBytes].fetch_sub(bytes, std::memory_order_relaxed);
+  if (this != &Process())
+    Process().counters_[kMemoryBytes].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void StatsCounters::RaiseLocal(Counter counter, uint64_t value) {
+  uint64_t current(counters_[counter].load(std::memory_order_relaxed));
+  while (current < value &&
+         !counters_[counter].compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+SelfEncryptorStats StatsCounters::Snapshot() const {
+  auto value([this](Counter counter) {
+    return counters_[counter].load(std::memory_order_relaxed);
+  });
+  SelfEncryptorStats stats;
+  stats.bytes_written = value(kBytesWritten);
+  stats.bytes_read = value(kBytesRead);
+  stats.chunks_fetched = value(kChunksFetched);
+  stats.chunks_decrypted = value(kChunksDecrypted);
+  stats.chunks_encrypted = value(kChunksEncrypted);
+  stats.chunks_stored = value(kChunksStored);
+  stats.cache_hits = value(kCacheHits);
+  stats.fetches_skipped = value(kFetchesSkipped);
+  stats.zero_chunks_reused = value(kZeroChunksReused);
+  stats.fetch_time = std::chrono::nanoseconds(value(kFetchTime));
+  stats.decrypt_time = std::chrono::nanoseconds(value(kDecryptTime));
+  stats.hash_time = std::chrono::nanoseconds(value(kHashTime));
+  stats.encrypt_time = std::chrono::nanoseconds(value(kEncryptTime));
+  stats.store_time = std::chrono::nanoseconds(value(kStoreTime));
+  stats.peak_sequencer_bytes = value(kPeakSequencerBytes);
+  stats.memory_bytes = value(kMemoryBytes);
+  stats.peak_memory_bytes = value(kPeakMemoryBytes);
+  return stats;
+}
+
+void StatsCounters::Reset() {
+  // Memory still held is a level rather than a count, so survives the reset.
+  for (int i(0); i != kCounterCount; ++i) {
+    if (i != kMemoryBytes)
+      counters_[i].store(0, std::memory_order_relaxed);
+  }
+  counters_[kPeakMemoryBytes].store(counters_[kMemoryBytes].load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+}
+
+StatsCounters& StatsCounters::Process() {
+  static StatsCounters process_counters;
+  return process_counters;
+}
+
+SelfEncryptorStats ProcessSelfEncryptorStats() { return StatsCounters::Process().Snapshot(); }
+
+void ResetProcessSelfEncryptorStats() { StatsCounters::Process().Reset(); }
+
+std::vector<std::pair<std::string, uint64_t>> ToNamedValues(const SelfEncryptorStats& stats) {
+  return std::vector<std::pair<std::string, uint64_t>>{
+      {"bytes_written", stats.bytes_written},
+      {"bytes_read", stats.bytes_read},
+      {"chunks_fetched", stats.chunks_fetched},
+      {"chunks_decrypted", stats.chunks_decrypted},
+      {"chunks_encrypted", stats.chunks_encrypted},
+      {"chunks_stored", stats.chunks_stored},
+      {"cache_hits", stats.cache_hits},
+      {"fetches_skipped", stats.fetches_skipped},
+      {"zero_chunks_reused", stats.zero_chunks_reused},
+      {"fetch_time_ns", static_cast<uint64_t>(stats.fetch_time.count())},
+      {"decrypt_time_ns", static_cast<uint64_t>(stats.decrypt_time.count())},
+      {"hash_time_ns", static_cast<uint64_t>(stats.hash_time.count())},
+      {"encrypt_time_ns", static_cast<uint64_t>(stats.encrypt_time.count())},
+      {"store_time_ns", static_cast<uint64_t>(stats.store_time.count())},
+      {"peak_sequencer_bytes", stats.peak_sequencer_bytes},
+      {"memory_bytes", stats.memory_bytes},
+      {"peak_memory_bytes", stats.peak_memory_bytes}};
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,127 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_STATS_COUNTERS_H_
+#define MAIDSAFE_ENCRYPT_STATS_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "maidsafe/encrypt/self_encryptor_stats.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+// Lock-free accumulator behind SelfEncryptorStats.  Every update is also applied to the
+// process-wide instance, using relaxed atomics since the counters are independent.
+class StatsCounters {
+ public:
+  enum Counter {
+    kBytesWritten,
+    kBytesRead,
+    kChunksFetched,
+    kChunksDecrypted,
+    kChunksEncrypted,
+    kChunksStored,
+    kCacheHits,
+    kFetchesSkipped,
+    kZeroChunksReused,
+    kFetchTime,
+    kDecryptTime,
+    kHashTime,
+    kEncryptTime,
+    kStoreTime,
+    kPeakSequencerBytes,
+    kMemoryBytes,
+    kPeakMemoryBytes,
+    kCounterCount
+  };
+
+  StatsCounters() : counters_() {
+    counters_[kMemoryBytes].store(0, std::memory_order_relaxed);
+    Reset();
+  }
+  StatsCounters(const StatsCounters&) = delete;
+  StatsCounters& operator=(const StatsCounters&) = delete;
+
+  void Add(Counter counter, uint64_t value);
+  // Raises |counter| to |value| if it is lower.
+  void RaiseTo(Counter counter, uint64_t value);
+  // Adjust kMemoryBytes and raise kPeakMemoryBytes to match.  The process-wide peak follows the
+  // process-wide total rather than any one encryptor's.
+  void AllocateMemory(uint64_t bytes);
+  void ReleaseMemory(uint64_t bytes);
+  SelfEncryptorStats Snapshot() const;
+  void Reset();
+
+  static StatsCounters& Process();
+
+ private:
+  void AddLocal(Counter counter, uint64_t value) {
+    counters_[counter].fetch_add(value, std::memory_order_relaxed);
+  }
+  void RaiseLocal(Counter counter, uint64_t value);
+  void AllocateLocal(uint64_t bytes) {
+    RaiseLocal(kPeakMemoryBytes,
+               counters_[kMemoryBytes].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  }
+
+  std::array<std::atomic<uint64_t>, kCounterCount> counters_;
+};
+
+// Charges a temporary buffer of |bytes| to the memory counters for as long as it is in scope.
+class MemoryCharge {
+ public:
+  MemoryCharge(StatsCounters& counters, uint64_t bytes) : counters_(counters), kBytes_(bytes) {
+    counters_.AllocateMemory(kBytes_);
+  }
+  ~MemoryCharge() { counters_.ReleaseMemory(kBytes_); }
+  MemoryCharge(const MemoryCharge&) = delete;
+  MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+ private:
+  StatsCounters& counters_;
+  const uint64_t kBytes_;
+};
+
+// Adds the time from construction to destruction to one of the time counters.
+class StageTimer {
+ public:
+  StageTimer(StatsCounters& counters, StatsCounters::Counter counter)
+      : counters_(counters), kCounter_(counter), kStart_(std::chrono::steady_clock::now()) {}
+  ~StageTimer() {
+    counters_.Add(kCounter_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - kStart_).count());
+  }
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+ private:
+  StatsCounters& counters_;
+  const StatsCounters::Counter kCounter_;
+  const std::chrono::steady_clock::time_point kStart_;
+};
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_STATS_COUNTERS_H_
@@ -16,15 +16,32 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include "boost/filesystem/operations.hpp"
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/test.h"
 
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/data_map_encryptor.h"
+#include "maidsafe/encrypt/data_map_patch.h"
+#include "maidsafe/encrypt/merkle_tree.h"
+#include "maidsafe/encrypt/self_decryptor.h"
 #include "maidsafe/encrypt/tests/encrypt_test_base.h"
+#include "maidsafe/encrypt/tests/perf_counters.h"
+#include "maidsafe/encrypt/tests/simulated_store.h"
+#include "maidsafe/encrypt/tests/synthetic_data.h"
 
 namespace fs = boost::filesystem;
 
@@ -34,69 +51,631 @@ namespace encrypt {
 
 namespace test {
 
-class Benchmark : public EncryptTestBase, public testing::TestWithParam<uint32_t> {
+// Writes then reads back 20 MB in pieces of the given size (0 for the whole file at once).
+class WriteReadBenchmark : public EncryptTestBase {
  public:
   typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
 
-  Benchmark()
+  explicit WriteReadBenchmark(uint32_t piece_size)
       : EncryptTestBase(),
         kTestDataSize_(1024 * 1024 * 20),
-        kPieceSize_(GetParam() ? GetParam() : kTestDataSize_) {
+        kPieceSize_(piece_size ? piece_size : kTestDataSize_),
+        perf_counters_() {
     original_.reset(new char[kTestDataSize_]);
     decrypted_.reset(new char[kTestDataSize_]);
   }
 
  protected:
   void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
-                   bool encrypting, bool compressible) {
+                   bool encrypting, const std::string& data_description) {
     uint64_t duration =
         std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
     if (duration == 0)
       duration = 1;
     uint64_t rate((static_cast<uint64_t>(kTestDataSize_) * 1000000) / duration);
     std::string encrypted(encrypting ? "Self-encrypted " : "Self-decrypted ");
-    std::string comp(compressible ? "compressible" : "incompressible");
-    std::cout << encrypted << BytesToDecimalSiUnits(kTestDataSize_) << " of " << comp << " data in "
-              << BytesToDecimalSiUnits(kPieceSize_) << " pieces in " << (duration / 1000)
-              << " milliseconds at a speed of " << BytesToDecimalSiUnits(rate) << "/s\n";
+    std::cout << encrypted << BytesToDecimalSiUnits(kTestDataSize_) << " of " << data_description
+              << " data in " << BytesToDecimalSiUnits(kPieceSize_) << " pieces in "
+              << (duration / 1000) << " milliseconds at a speed of " << BytesToDecimalSiUnits(rate)
+              << "/s\n";
+    if (perf_counters_.available())
+      std::cout << "  " << perf_counters_.PerByte(kTestDataSize_) << '\n';
   }
-  void WriteThenRead(bool compressible) {
+  void WriteThenRead(const std::string& data_description) {
     chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+    perf_counters_.Start();
     for (uint32_t i(0); i < kTestDataSize_; i += kPieceSize_)
       ASSERT_TRUE(self_encryptor_->Write(&original_[i], kPieceSize_, i));
     self_encryptor_->Close();
+    perf_counters_.Stop();
     chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
-    PrintResult(start_time, stop_time, true, compressible);
+    PrintResult(start_time, stop_time, true, data_description);
+    CheckMemoryCeiling();
 
     self_encryptor_ =
         maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
     start_time = std::chrono::high_resolution_clock::now();
+    perf_counters_.Start();
     for (uint32_t i(0); i < kTestDataSize_; i += kPieceSize_)
       ASSERT_TRUE(self_encryptor_->Read(&decrypted_[i], kPieceSize_, i));
+    perf_counters_.Stop();
     stop_time = std::chrono::high_resolution_clock::now();
     for (uint32_t i(0); i < kTestDataSize_; ++i)
       ASSERT_EQ(original_[i], decrypted_[i]) << "failed @ count " << i;
-    PrintResult(start_time, stop_time, false, compressible);
+    PrintResult(start_time, stop_time, false, data_description);
+    CheckMemoryCeiling();
     self_encryptor_->Close();
   }
+  // The file buffer holds the file rounded up to whole chunks, and Close needs up to three
+  // chunk-sized buffers for each chunk being encrypted.
+  void CheckMemoryCeiling() {
+    uint64_t peak(self_encryptor_->stats().peak_memory_bytes);
+    std::cout << "  Peak memory " << BytesToDecimalSiUnits(peak) << '\n';
+    EXPECT_LE(peak, 5ULL * kTestDataSize_);
+  }
   const uint32_t kTestDataSize_, kPieceSize_;
+  PerfCounters perf_counters_;
+};
+
+class Benchmark : public testing::TestWithParam<uint32_t>, public WriteReadBenchmark {
+ public:
+  Benchmark() : WriteReadBenchmark(GetParam()) {}
 };
 
 TEST_P(Benchmark, FUNC_BenchmarkCompressible) {
   memset(original_.get(), 'a', kTestDataSize_);
-  WriteThenRead(true);
+  WriteThenRead("compressible");
 }
 
 TEST_P(Benchmark, FUNC_BenchmarkIncompressible) {
   memcpy(original_.get(), RandomString(kTestDataSize_).data(), kTestDataSize_);
-  WriteThenRead(false);
+  WriteThenRead("incompressible");
 }
 
 INSTANTIATE_TEST_CASE_P(WriteRead, Benchmark, testing::Values(0, 4096, 65536, 1048576));
 
+// Data between the all-'a' and random extremes above, generated from a fixed seed so that runs are
+// comparable.
+class SyntheticDataBenchmark
+    : public testing::TestWithParam<std::tuple<uint32_t, SyntheticDataProfile>>,
+      public WriteReadBenchmark {
+ public:
+  SyntheticDataBenchmark() : WriteReadBenchmark(std::get<0>(GetParam())) {}
+};
+
+TEST_P(SyntheticDataBenchmark, FUNC_Benchmark) {
+  const SyntheticDataProfile& profile(std::get<1>(GetParam()));
+  GenerateSyntheticData(profile, 1, original_.get(), kTestDataSize_);
+  std::ostringstream description;
+  description << "synthetic (" << profile << ")";
+  WriteThenRead(description.str());
+}
+
+INSTANTIATE_TEST_CASE_P(
+    WriteRead, SyntheticDataBenchmark,
+    testing::Combine(testing::Values(4096, 1048576),
+                     testing::Values(SyntheticDataProfile(3.0, 0.0, 1.0),    // Text-like
+                                     SyntheticDataProfile(1.2, 0.2, 1.0),    // Media, some copies
+                                     SyntheticDataProfile(2.0, 0.0, 0.05),   // Sparse
+                                     SyntheticDataProfile(1.0, 0.5, 1.0))));  // Heavily duplicated
+
+// Reads back a file through a SimulatedStore, so that fetch-bound paths are measured against
+// remote-store behaviour rather than the zero-latency local buffer.
+class StoreLatencyBenchmark : public EncryptTestBase,
+                              public testing::TestWithParam<std::pair<const char*,
+                                                                      SimulatedStoreProfile>> {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+  StoreLatencyBenchmark()
+      : EncryptTestBase(),
+        kTestDataSize_(1024 * 1024 * 20),
+        kRandomReadSize_(4096),
+        kRandomReads_(64),
+        simulated_store_(get_from_store_, GetParam().second) {
+    original_.reset(new char[kTestDataSize_]);
+    decrypted_.reset(new char[kTestDataSize_]);
+    memcpy(original_.get(), RandomString(kTestDataSize_).data(), kTestDataSize_);
+  }
+
+ protected:
+  // Retries failed fetches, as a client of an unreliable store would.
+  std::function<NonEmptyString(const std::string&)> RetryingGetter() {
+    return [this](const std::string& name) -> NonEmptyString {
+      for (int attempt(1);; ++attempt) {
+        try {
+          return simulated_store_.Get(name);
+        }
+        catch (const std::exception&) {
+          if (attempt == 5)
+            throw;
+        }
+      }
+    };
+  }
+  void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                   const std::string& action, uint64_t bytes) {
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    std::cout << GetParam().first << " store: " << action << " " << BytesToDecimalSiUnits(bytes)
+              << " in " << (duration / 1000) << " milliseconds at a speed of "
+              << BytesToDecimalSiUnits((bytes * 1000000) / duration) << "/s\n";
+  }
+  const uint32_t kTestDataSize_, kRandomReadSize_, kRandomReads_;
+  SimulatedStore simulated_store_;
+};
+
+TEST_P(StoreLatencyBenchmark, FUNC_ReadThroughStore) {
+  ASSERT_TRUE(self_encryptor_->Write(original_.get(), kTestDataSize_, 0));
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, RetryingGetter());
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  ASSERT_TRUE(self_encryptor_->Read(decrypted_.get(), kTestDataSize_, 0));
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  ASSERT_EQ(0, memcmp(original_.get(), decrypted_.get(), kTestDataSize_));
+  PrintResult(start_time, stop_time, "sequentially read", kTestDataSize_);
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, RetryingGetter());
+  start_time = std::chrono::high_resolution_clock::now();
+  for (uint32_t i(0); i != kRandomReads_; ++i) {
+    uint32_t position(RandomUint32() % (kTestDataSize_ - kRandomReadSize_));
+    ASSERT_TRUE(self_encryptor_->Read(decrypted_.get(), kRandomReadSize_, position));
+    ASSERT_EQ(0, memcmp(original_.get() + position, decrypted_.get(), kRandomReadSize_));
+  }
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "randomly read", kRandomReads_ * kRandomReadSize_);
+  self_encryptor_->Close();
+
+  SimulatedStore::Statistics statistics(simulated_store_.statistics());
+  std::cout << GetParam().first << " store: " << statistics.gets << " gets ("
+            << statistics.failures << " failed), " << BytesToDecimalSiUnits(statistics.bytes)
+            << " transferred, " << statistics.queued.count() / 1000 << " ms queued, "
+            << statistics.busy.count() / 1000 << " ms busy\n";
+}
+
+INSTANTIATE_TEST_CASE_P(
+    SimulatedStores, StoreLatencyBenchmark,
+    testing::Values(
+        std::make_pair("Local", SimulatedStoreProfile()),
+        std::make_pair("LAN", SimulatedStoreProfile(std::chrono::microseconds(500), 0.3,
+                                                    100 * 1000 * 1000, 16, 0.0)),
+        std::make_pair("WAN", SimulatedStoreProfile(std::chrono::milliseconds(40), 0.5,
+                                                    10 * 1000 * 1000, 4, 0.0)),
+        std::make_pair("Unreliable WAN",
+                       SimulatedStoreProfile(std::chrono::milliseconds(40), 0.8,
+                                             5 * 1000 * 1000, 4, 0.02))));
+
+// Creates, opens and closes files of up to a million chunks.  They're wholly sparse, so every chunk
+// shares one encrypted chunk and the time measured is the per-chunk bookkeeping.
+class ManyChunksBenchmark : public EncryptTestBase, public testing::TestWithParam<uint32_t> {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+ protected:
+  void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                   const std::string& action) {
+    std::cout << action << " a file of " << GetParam() << " chunks in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop_time - start_time)
+                     .count() << " milliseconds\n";
+  }
+};
+
+TEST_P(ManyChunksBenchmark, FUNC_OpenAndClose) {
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  ASSERT_TRUE(self_encryptor_->Truncate(static_cast<uint64_t>(GetParam()) * kMaxChunkSize));
+  self_encryptor_->Close();
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  PrintResult(start_time, stop_time, "Created and closed");
+  ASSERT_EQ(GetParam(), data_map_.chunks.size());
+
+  start_time = std::chrono::high_resolution_clock::now();
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Opened");
+
+  start_time = std::chrono::high_resolution_clock::now();
+  self_encryptor_->Close();
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Closed unchanged");
+}
+
+INSTANTIATE_TEST_CASE_P(Chunks, ManyChunksBenchmark, testing::Values(10000, 100000, 1000000));
+
+// Reads a file from one encryptor on several threads at once, first while its chunks are still
+// remote so readers contend for the same fetches, then again once it's wholly in memory.
+class ConcurrentReadBenchmark : public EncryptTestBase, public testing::TestWithParam<uint32_t> {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+  ConcurrentReadBenchmark()
+      : EncryptTestBase(),
+        kTestDataSize_(1024 * 1024 * 20),
+        kReadSize_(4096),
+        kReadsPerThread_(2048),
+        kContent_(RandomString(kTestDataSize_)) {}
+
+ protected:
+  // Each thread reads kReadsPerThread_ pieces spread across the file, starting at its own offset.
+  void ReadOnAllThreads(const std::string& action,
+                        const std::function<bool(char*, uint32_t, uint64_t)>& read_file) {
+    chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+    std::vector<std::future<bool>> readers;
+    for (uint32_t i(0); i != GetParam(); ++i) {
+      readers.emplace_back(std::async(std::launch::async, [this, i, &read_file]() -> bool {
+        const uint32_t kNumPieces(kTestDataSize_ / kReadSize_);
+        std::string read(kReadSize_, 0);
+        for (uint32_t j(0); j != kReadsPerThread_; ++j) {
+          uint32_t position(((i * 7919 + j * 104729) % kNumPieces) * kReadSize_);
+          if (!read_file(&read[0], kReadSize_, position) ||
+              read.compare(0, kReadSize_, kContent_, position, kReadSize_) != 0) {
+            return false;
+          }
+        }
+        return true;
+      }));
+    }
+    for (auto& reader : readers)
+      ASSERT_TRUE(reader.get());
+    chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    uint64_t bytes(static_cast<uint64_t>(GetParam()) * kReadsPerThread_ * kReadSize_);
+    std::cout << action << " " << BytesToDecimalSiUnits(bytes) << " on " << GetParam()
+              << " threads in " << (duration / 1000) << " milliseconds at a speed of "
+              << BytesToDecimalSiUnits((bytes * 1000000) / duration) << "/s\n";
+  }
+  const uint32_t kTestDataSize_, kReadSize_, kReadsPerThread_;
+  const std::string kContent_;
+};
+
+TEST_P(ConcurrentReadBenchmark, FUNC_Read) {
+  ASSERT_TRUE(self_encryptor_->Write(kContent_.data(), kTestDataSize_, 0));
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  auto encryptor_read([this](char* data, uint32_t length, uint64_t position) {
+    return self_encryptor_->Read(data, length, position);
+  });
+  ReadOnAllThreads("Cold-read", encryptor_read);
+  // However many threads missed a chunk, it should only have been fetched once.
+  std::cout << "  " << self_encryptor_->stats().chunks_fetched << " chunks fetched for "
+            << data_map_.chunks.size() << " in the file\n";
+  EXPECT_LE(self_encryptor_->stats().chunks_fetched, data_map_.chunks.size());
+  ReadOnAllThreads("Warm-read", encryptor_read);
+  self_encryptor_->Close();
+
+  // The read-only path, with a cache big enough for the whole file.
+  SelfDecryptor decryptor(data_map_, get_from_store_,
+                          std::make_shared<ChunkCache>(16ULL * kTestDataSize_));
+  auto decryptor_read([&decryptor](char* data, uint32_t length, uint64_t position) {
+    return decryptor.Read(data, length, position);
+  });
+  ReadOnAllThreads("SelfDecryptor cold-read", decryptor_read);
+  ReadOnAllThreads("SelfDecryptor warm-read", decryptor_read);
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, ConcurrentReadBenchmark, testing::Values(1, 2, 4, 8, 16));
+
+// Writes a file from one encryptor on several threads at once, each thread overwriting its own
+// contiguous region in small pieces.
+class ParallelWriteBenchmark : public EncryptTestBase, public testing::TestWithParam<uint32_t> {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+  ParallelWriteBenchmark()
+      : EncryptTestBase(),
+        kTestDataSize_(1024 * 1024 * 64),
+        kWriteSize_(65536),
+        kContent_(RandomString(kTestDataSize_)) {}
+
+ protected:
+  void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                   const std::string& action) {
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    std::cout << action << " " << BytesToDecimalSiUnits(kTestDataSize_) << " on " << GetParam()
+              << " threads in " << (duration / 1000) << " milliseconds at a speed of "
+              << BytesToDecimalSiUnits((static_cast<uint64_t>(kTestDataSize_) * 1000000) / duration)
+              << "/s\n";
+  }
+  const uint32_t kTestDataSize_, kWriteSize_;
+  const std::string kContent_;
+};
+
+TEST_P(ParallelWriteBenchmark, FUNC_Write) {
+  // The file is made two chunks bigger than the data so that no write reaches its last two chunks.
+  ASSERT_TRUE(self_encryptor_->Truncate(kTestDataSize_ + 2 * kMaxChunkSize));
+  const uint32_t kRegionSize(kTestDataSize_ / GetParam());
+
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  std::vector<std::future<bool>> writers;
+  for (uint32_t i(0); i != GetParam(); ++i) {
+    writers.emplace_back(std::async(std::launch::async, [this, i, kRegionSize]() -> bool {
+      for (uint32_t offset(0); offset < kRegionSize; offset += kWriteSize_) {
+        uint32_t position(i * kRegionSize + offset);
+        uint32_t length(std::min(kWriteSize_, kRegionSize - offset));
+        if (!self_encryptor_->Write(kContent_.data() + position, length, position))
+          return false;
+      }
+      return true;
+    }));
+  }
+  for (auto& writer : writers)
+    ASSERT_TRUE(writer.get());
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  PrintResult(start_time, stop_time, "Wrote");
+
+  start_time = std::chrono::high_resolution_clock::now();
+  self_encryptor_->Close();
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Closed");
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(kTestDataSize_, 0);
+  ASSERT_TRUE(self_encryptor_->Read(&read[0], kTestDataSize_, 0));
+  EXPECT_TRUE(read == kContent_);
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, ParallelWriteBenchmark, testing::Values(1, 2, 4, 8, 16, 32));
+
+// Grows a file to 1 GB by appending small pieces, with and without reserving its size up front.
+class AppendBenchmark : public EncryptTestBase, public testing::TestWithParam<bool> {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+  AppendBenchmark()
+      : EncryptTestBase(),
+        kFileSize_(1024ULL * 1024 * 1024),
+        kPieceSize_(4096),
+        kPattern_(RandomString(kMaxChunkSize)) {}
+
+ protected:
+  void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                   const std::string& action) {
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    std::cout << action << " " << BytesToDecimalSiUnits(kFileSize_) << " in "
+              << BytesToDecimalSiUnits(kPieceSize_) << " pieces"
+              << (GetParam() ? " after reserving" : "") << " in " << (duration / 1000)
+              << " milliseconds at a speed of "
+              << BytesToDecimalSiUnits((kFileSize_ * 1000000) / duration) << "/s\n";
+  }
+  const uint64_t kFileSize_;
+  const uint32_t kPieceSize_;
+  const std::string kPattern_;
+};
+
+TEST_P(AppendBenchmark, FUNC_Append) {
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  if (GetParam())
+    self_encryptor_->Reserve(kFileSize_);
+  for (uint64_t position(0); position < kFileSize_; position += kPieceSize_) {
+    ASSERT_TRUE(self_encryptor_->Write(kPattern_.data() + position % kPattern_.size(),
+                                       kPieceSize_, position));
+  }
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  PrintResult(start_time, stop_time, "Appended");
+  ASSERT_EQ(kFileSize_, self_encryptor_->size());
+
+  start_time = std::chrono::high_resolution_clock::now();
+  self_encryptor_->Close();
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Closed");
+}
+
+INSTANTIATE_TEST_CASE_P(Reserve, AppendBenchmark, testing::Bool());
+
+class DataMapBenchmark : public testing::Test {
+ public:
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+
+  DataMapBenchmark()
+      : kNumChunks_(1000000),
+        kParentId_(RandomString(64)),
+        kThisId_(RandomString(64)),
+        test_dir_(maidsafe::test::CreateTestPath()),
+        data_map_(CreateSyntheticDataMap(kNumChunks_)) {}
+
+ protected:
+  void PrintResult(const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                   const std::string& action, uint64_t encrypted_size) {
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    uint64_t rate((encrypted_size * 1000000) / duration);
+    std::cout << action << " data map of " << kNumChunks_ << " chunks ("
+              << BytesToDecimalSiUnits(encrypted_size) << ") in " << (duration / 1000)
+              << " milliseconds at a speed of " << BytesToDecimalSiUnits(rate) << "/s\n";
+  }
+  const uint32_t kNumChunks_;
+  const Identity kParentId_, kThisId_;
+  maidsafe::test::TestPath test_dir_;
+  DataMap data_map_;
+};
+
+TEST_F(DataMapBenchmark, FUNC_EncryptDecrypt) {
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  crypto::CipherText encrypted(EncryptDataMap(kParentId_, kThisId_, data_map_));
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  PrintResult(start_time, stop_time, "Encrypted", encrypted.string().size());
+
+  start_time = std::chrono::high_resolution_clock::now();
+  DataMap retrieved_data_map(DecryptDataMap(kParentId_, kThisId_, encrypted.string()));
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Decrypted", encrypted.string().size());
+  EXPECT_EQ(data_map_, retrieved_data_map);
+}
+
+TEST_F(DataMapBenchmark, FUNC_StreamingEncryptDecrypt) {
+  fs::path encrypted_path(*test_dir_ / "encrypted_data_map");
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  {
+    std::ofstream sink(encrypted_path.string(), std::ios::binary);
+    EncryptDataMap(kParentId_, kThisId_, data_map_, sink);
+  }
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  uint64_t encrypted_size(fs::file_size(encrypted_path));
+  PrintResult(start_time, stop_time, "Stream-encrypted", encrypted_size);
+
+  start_time = std::chrono::high_resolution_clock::now();
+  std::ifstream source(encrypted_path.string(), std::ios::binary);
+  DataMap retrieved_data_map(DecryptDataMap(kParentId_, kThisId_, source));
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Stream-decrypted", encrypted_size);
+  EXPECT_EQ(data_map_, retrieved_data_map);
+}
+
+// Replicating a one-chunk change to a large data map as a patch vs as the whole serialised map.
+TEST_F(DataMapBenchmark, FUNC_DiffAndPatch) {
+  DataMap modified_data_map(data_map_);
+  modified_data_map.chunks[kNumChunks_ / 2].hash.assign(crypto::SHA512::DIGESTSIZE, 0);
+
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  std::string serialised;
+  SerialiseDataMap(modified_data_map, serialised);
+  DataMap parsed_data_map;
+  ParseDataMap(serialised, parsed_data_map);
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  PrintResult(start_time, stop_time, "Serialised and parsed", serialised.size());
+
+  start_time = std::chrono::high_resolution_clock::now();
+  std::string serialised_patch;
+  SerialiseDataMapPatch(DiffDataMaps(data_map_, modified_data_map), serialised_patch);
+  DataMapPatch patch;
+  ParseDataMapPatch(serialised_patch, patch);
+  ApplyPatch(patch, data_map_);
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Diffed, serialised and applied patch to",
+              serialised_patch.size());
+  EXPECT_EQ(modified_data_map, data_map_);
+  EXPECT_EQ(modified_data_map, parsed_data_map);
+
+  // With a Merkle root the base is fingerprinted without reading its chunks.
+  DataMap rooted_data_map(data_map_);
+  rooted_data_map.merkle_root = MerkleTree(rooted_data_map).root();
+  modified_data_map = rooted_data_map;
+  modified_data_map.chunks[kNumChunks_ / 3].hash.assign(crypto::SHA512::DIGESTSIZE, 1);
+  modified_data_map.merkle_root = MerkleTree(modified_data_map).root();
+  start_time = std::chrono::high_resolution_clock::now();
+  SerialiseDataMapPatch(DiffDataMaps(rooted_data_map, modified_data_map), serialised_patch);
+  ParseDataMapPatch(serialised_patch, patch);
+  ApplyPatch(patch, rooted_data_map);
+  stop_time = std::chrono::high_resolution_clock::now();
+  PrintResult(start_time, stop_time, "Diffed, serialised and applied patch to rooted",
+              serialised_patch.size());
+  EXPECT_EQ(modified_data_map, rooted_data_map);
+}
+
+// Compares the serialised size of typical data maps (the size kDataMapEncryptionVersion0 stored)
+// with their compressed and encrypted size, and times encryption and decryption of each.
+TEST(DataMapCompressionBenchmark, FUNC_SizeAndCost) {
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  std::vector<std::pair<std::string, DataMap>> data_maps;
+  data_maps.emplace_back("1 GB file", CreateSyntheticDataMap(1024));
+  data_maps.emplace_back("4 MB file", CreateSyntheticDataMap(4));
+  DataMap text_file;
+  const std::string kText("Lorem ipsum dolor sit amet, consectetur adipiscing elit.\n");
+  while (text_file.content.size() + kText.size() < 3 * kMinChunkSize)
+    text_file.content.insert(std::end(text_file.content), std::begin(kText), std::end(kText));
+  data_maps.emplace_back("small text file", text_file);
+  DataMap binary_file;
+  const std::string kBinary(RandomString(3 * kMinChunkSize - 1));
+  binary_file.content.assign(std::begin(kBinary), std::end(kBinary));
+  data_maps.emplace_back("small binary file", binary_file);
+
+  const int kIterations(100);
+  for (const auto& data_map : data_maps) {
+    std::string serialised_data_map;
+    SerialiseDataMap(data_map.second, serialised_data_map);
+    crypto::CipherText encrypted(EncryptDataMap(kParentId, kThisId, data_map.second));
+
+    chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+    for (int i(0); i != kIterations; ++i)
+      EncryptDataMap(kParentId, kThisId, data_map.second);
+    chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+    uint64_t encrypt_duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int i(0); i != kIterations; ++i)
+      DecryptDataMap(kParentId, kThisId, encrypted.string());
+    stop_time = std::chrono::high_resolution_clock::now();
+    uint64_t decrypt_duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+
+    std::cout << "Data map of " << data_map.first << ": serialised "
+              << BytesToDecimalSiUnits(serialised_data_map.size()) << ", encrypted "
+              << BytesToDecimalSiUnits(encrypted.string().size()) << " ("
+              << (100 * encrypted.string().size()) / serialised_data_map.size()
+              << "%), encrypt " << encrypt_duration / kIterations << " us, decrypt "
+              << decrypt_duration / kIterations << " us\n";
+    EXPECT_EQ(data_map.second, DecryptDataMap(kParentId, kThisId, encrypted.string()));
+  }
+}
+
+// Encrypts and decrypts the data maps of a directory listing one at a time and as a batch.
+TEST(DataMapBatchBenchmark, FUNC_EncryptDecryptDirectory) {
+  typedef std::chrono::time_point<std::chrono::high_resolution_clock> chrono_time_point;
+  const size_t kNumDataMaps(10000);
+  const Identity kParentId(RandomString(64));
+  std::vector<std::pair<Identity, DataMap>> data_maps;
+  for (size_t i(0); i != kNumDataMaps; ++i)
+    data_maps.emplace_back(Identity(RandomString(64)), CreateSyntheticDataMap(10));
+
+  auto print_result([&](const chrono_time_point& start_time, const chrono_time_point& stop_time,
+                        const std::string& action) {
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count();
+    if (duration == 0)
+      duration = 1;
+    std::cout << action << " " << kNumDataMaps << " data maps in " << (duration / 1000)
+              << " milliseconds at " << (kNumDataMaps * 1000000) / duration << " maps/s\n";
+  });
+
+  std::vector<std::pair<Identity, std::string>> encrypted_data_maps;
+  chrono_time_point start_time(std::chrono::high_resolution_clock::now());
+  for (const auto& data_map : data_maps) {
+    encrypted_data_maps.emplace_back(
+        data_map.first, EncryptDataMap(kParentId, data_map.first, data_map.second).string());
+  }
+  chrono_time_point stop_time(std::chrono::high_resolution_clock::now());
+  print_result(start_time, stop_time, "Encrypted individually");
+
+  start_time = std::chrono::high_resolution_clock::now();
+  for (const auto& encrypted_data_map : encrypted_data_maps)
+    DecryptDataMap(kParentId, encrypted_data_map.first, encrypted_data_map.second);
+  stop_time = std::chrono::high_resolution_clock::now();
+  print_result(start_time, stop_time, "Decrypted individually");
+
+  start_time = std::chrono::high_resolution_clock::now();
+  std::vector<crypto::CipherText> encrypted(EncryptDataMaps(kParentId, data_maps));
+  stop_time = std::chrono::high_resolution_clock::now();
+  print_result(start_time, stop_time, "Encrypted as batch");
+  ASSERT_EQ(kNumDataMaps, encrypted.size());
+
+  start_time = std::chrono::high_resolution_clock::now();
+  std::vector<DataMap> decrypted(DecryptDataMaps(kParentId, encrypted_data_maps));
+  stop_time = std::chrono::high_resolution_clock::now();
+  print_result(start_time, stop_time, "Decrypted as batch");
+  ASSERT_EQ(kNumDataMaps, decrypted.size());
+  for (size_t i(0); i != kNumDataMaps; ++i)
+    EXPECT_EQ(data_maps[i].second, decrypted[i]);
+}
+
 // This test is to allow confirmation that memory usage is capped at an
-// acceptable level.  While the test is running, memory usage must be visually
-// monitored.
+// acceptable level.
 TEST(MassiveFile, FUNC_MemCheck) {
   maidsafe::test::TestPath test_dir(maidsafe::test::CreateTestPath());
   fs::path store_path(*test_dir / "data_store");
@@ -124,6 +703,10 @@ TEST(MassiveFile, FUNC_MemCheck) {
 
   LOG(kInfo) << "Resetting self encryptor.";
   self_encryptor->Close();
+  uint64_t peak(self_encryptor->stats().peak_memory_bytes);
+  std::cout << "Peak memory writing " << BytesToDecimalSiUnits(200ULL * kDataSize) << " was "
+            << BytesToDecimalSiUnits(peak) << '\n';
+  EXPECT_LE(peak, 5ULL * 200 * kDataSize);
 }
 
 }  // namespace test
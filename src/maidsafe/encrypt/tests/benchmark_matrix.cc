@@ -0,0 +1,459 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Configurable benchmark driver for SelfEncryptor.  Runs every combination of the given file sizes,
+// piece sizes, access patterns and thread counts (each thread driving its own independent
+// encryptor and store), and writes the throughput and per-call latency percentiles of each phase
+// as JSON.  Run with --help for the options.
+//
+// Note that a SelfEncryptor currently holds the whole file in memory, so each thread needs about
+// the file size in RAM.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/exception/all.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/data_buffer.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/tracer.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace benchmark {
+
+namespace {
+
+typedef std::chrono::steady_clock chrono_clock;
+
+enum class AccessPattern { kSequential, kRandom, kStrided };
+
+struct Options {
+  Options()
+      : file_sizes(1, 20 * 1024 * 1024),
+        piece_sizes({4096, 65536, 1048576}),
+        patterns({AccessPattern::kSequential, AccessPattern::kRandom, AccessPattern::kStrided}),
+        thread_counts(1, 1),
+        stride(16),
+        modify_cycles(3),
+        modify_percent(10),
+        store_memory(512 * 1024 * 1024),
+        verify(false),
+        store_dir(fs::temp_directory_path()),
+        output(),
+        trace() {}
+
+  std::vector<uint64_t> file_sizes;
+  std::vector<uint32_t> piece_sizes;
+  std::vector<AccessPattern> patterns;
+  std::vector<int> thread_counts;
+  uint32_t stride;  // In pieces
+  int modify_cycles;
+  int modify_percent;     // Of the file's pieces rewritten per modify cycle
+  uint64_t store_memory;  // Per thread, before chunks spill to disk
+  bool verify;
+  fs::path store_dir;
+  std::string output;  // Empty for stdout
+  std::string trace;   // Chrome trace of the chunk pipeline, if not empty
+};
+
+struct PhaseResult {
+  PhaseResult() : bytes(0), duration(chrono_clock::duration::zero()), latencies() {}
+  uint64_t bytes;
+  chrono_clock::duration duration;                 // Including the final Close()
+  std::vector<chrono_clock::duration> latencies;  // Of each Read or Write call
+};
+
+struct CaseResult {
+  uint64_t file_size;
+  uint32_t piece_size;
+  AccessPattern pattern;
+  int threads;
+  std::vector<std::pair<std::string, PhaseResult>> phases;
+};
+
+const char* ToString(AccessPattern pattern) {
+  switch (pattern) {
+    case AccessPattern::kSequential:
+      return "sequential";
+    case AccessPattern::kRandom:
+      return "random";
+    default:
+      return "strided";
+  }
+}
+
+// Parses e.g. "4096", "64K", "20M" or "10G" (binary units).
+uint64_t ParseSize(const std::string& text) {
+  size_t end(0);
+  uint64_t size(std::stoull(text, &end));
+  if (end + 1 == text.size()) {
+    switch (text[end]) {
+      case 'K': case 'k': return size << 10;
+      case 'M': case 'm': return size << 20;
+      case 'G': case 'g': return size << 30;
+      default: break;
+    }
+  } else if (end == text.size() && size != 0) {
+    return size;
+  }
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+}
+
+std::vector<std::string> Split(const std::string& list) {
+  std::vector<std::string> items;
+  std::istringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    items.push_back(item);
+  if (items.empty())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  return items;
+}
+
+void PrintUsage() {
+  std::cout
+      << "Usage: benchmark_matrix_encrypt [options]\n"
+      << "  --file-sizes <list>     File sizes, e.g. 20M,1G,4G (default 20M).  Each thread holds\n"
+      << "                          its whole file in memory\n"
+      << "  --piece-sizes <list>    Read/write call sizes (default 4K,64K,1M)\n"
+      << "  --patterns <list>       Any of sequential,random,strided (default all)\n"
+      << "  --threads <list>        Independent encryptors run concurrently (default 1)\n"
+      << "  --stride <n>            Pieces skipped per strided access (default 16)\n"
+      << "  --modify-cycles <n>     Reopen-and-modify cycles after reading (default 3)\n"
+      << "  --modify-percent <n>    Percentage of pieces rewritten per cycle (default 10)\n"
+      << "  --store-memory <size>   Per-thread chunk store memory (default 512M)\n"
+      << "  --store-dir <path>      Where chunks spill to disk (default system temp)\n"
+      << "  --verify                Check the data read back\n"
+      << "  --output <file>         Write JSON here rather than to stdout\n"
+      << "  --trace <file>          Write a Chrome trace of the chunk pipeline\n";
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+  for (int i(1); i < argc; ++i) {
+    std::string option(argv[i]);
+    if (option == "--verify") {
+      options.verify = true;
+      continue;
+    }
+    if (option == "--help" || i + 1 == argc)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    std::string value(argv[++i]);
+    if (option == "--file-sizes") {
+      options.file_sizes.clear();
+      for (const auto& item : Split(value))
+        options.file_sizes.push_back(ParseSize(item));
+    } else if (option == "--piece-sizes") {
+      options.piece_sizes.clear();
+      for (const auto& item : Split(value))
+        options.piece_sizes.push_back(static_cast<uint32_t>(ParseSize(item)));
+    } else if (option == "--patterns") {
+      options.patterns.clear();
+      for (const auto& item : Split(value)) {
+        if (item == "sequential")
+          options.patterns.push_back(AccessPattern::kSequential);
+        else if (item == "random")
+          options.patterns.push_back(AccessPattern::kRandom);
+        else if (item == "strided")
+          options.patterns.push_back(AccessPattern::kStrided);
+        else
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      }
+    } else if (option == "--threads") {
+      options.thread_counts.clear();
+      for (const auto& item : Split(value))
+        options.thread_counts.push_back(static_cast<int>(ParseSize(item)));
+    } else if (option == "--stride") {
+      options.stride = static_cast<uint32_t>(ParseSize(value));
+    } else if (option == "--modify-cycles") {
+      options.modify_cycles = std::stoi(value);
+    } else if (option == "--modify-percent") {
+      options.modify_percent = std::stoi(value);
+    } else if (option == "--store-memory") {
+      options.store_memory = ParseSize(value);
+    } else if (option == "--store-dir") {
+      options.store_dir = value;
+    } else if (option == "--output") {
+      options.output = value;
+    } else if (option == "--trace") {
+      options.trace = value;
+    } else {
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+  if (options.modify_cycles < 0 || options.modify_percent < 0 || options.modify_percent > 100)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  return options;
+}
+
+// Source data is cut from a random pool whose period isn't a multiple of any chunk size, so no two
+// chunks of a file smaller than the period are identical.
+class DataSource {
+ public:
+  explicit DataSource(uint32_t max_piece_size)
+      : kPeriod_(64 * 1024 * 1024 + 4093), pool_(RandomString(kPeriod_ + max_piece_size)) {}
+  // |generation| gives the data for successive rewrites of a position different content.
+  const char* Data(uint64_t position, int generation = 0) const {
+    return &pool_[(position + generation * 7919ULL) % kPeriod_];
+  }
+
+ private:
+  const uint64_t kPeriod_;
+  const std::string pool_;
+};
+
+// Offsets of each piece of the file, in the order the pattern visits them.
+std::vector<uint64_t> Offsets(AccessPattern pattern, uint64_t file_size, uint32_t piece_size,
+                              uint32_t stride, std::mt19937_64& rng) {
+  uint64_t num_pieces((file_size + piece_size - 1) / piece_size);
+  std::vector<uint64_t> offsets;
+  offsets.reserve(static_cast<size_t>(num_pieces));
+  if (pattern == AccessPattern::kStrided) {
+    for (uint64_t start(0); start != std::min<uint64_t>(stride, num_pieces); ++start) {
+      for (uint64_t piece(start); piece < num_pieces; piece += stride)
+        offsets.push_back(piece * piece_size);
+    }
+  } else {
+    for (uint64_t piece(0); piece != num_pieces; ++piece)
+      offsets.push_back(piece * piece_size);
+    if (pattern == AccessPattern::kRandom)
+      std::shuffle(std::begin(offsets), std::end(offsets), rng);
+  }
+  return offsets;
+}
+
+uint32_t PieceLength(uint64_t offset, uint64_t file_size, uint32_t piece_size) {
+  return static_cast<uint32_t>(std::min<uint64_t>(piece_size, file_size - offset));
+}
+
+// Runs the write, read and modify phases on one encryptor with its own store.
+std::vector<std::pair<std::string, PhaseResult>> RunThread(const Options& options,
+                                                           const DataSource& source,
+                                                           uint64_t file_size, uint32_t piece_size,
+                                                           AccessPattern pattern, int thread,
+                                                           Tracer* tracer) {
+  std::mt19937_64 rng(thread + 1);
+  fs::path store_path(options.store_dir /
+                      fs::unique_path("benchmark_matrix_%%%%-%%%%-%%%%-%%%%"));
+  std::vector<std::pair<std::string, PhaseResult>> phases;
+  {
+    DataBuffer<std::string> store(
+        MemoryUsage(options.store_memory), DiskUsage(std::numeric_limits<uint64_t>::max()),
+        [](const std::string&, const NonEmptyString&) {
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::cannot_exceed_limit));
+        },
+        store_path);
+    auto get_from_store([&store](const std::string& name) { return store.Get(name); });
+    DataMap data_map;
+    std::vector<uint64_t> offsets(Offsets(pattern, file_size, piece_size, options.stride, rng));
+
+    // Times each call made by |functor| for every offset, then the Close() which follows.
+    auto run_phase([&](const std::string& name, const std::vector<uint64_t>& phase_offsets,
+                       const std::function<void(SelfEncryptor&, uint64_t, uint32_t)>& functor) {
+      PhaseResult result;
+      result.latencies.reserve(phase_offsets.size());
+      auto phase_start(chrono_clock::now());
+      SelfEncryptor encryptor(data_map, store, get_from_store);
+      encryptor.set_tracer(tracer);
+      for (uint64_t offset : phase_offsets) {
+        uint32_t length(PieceLength(offset, file_size, piece_size));
+        auto start(chrono_clock::now());
+        functor(encryptor, offset, length);
+        result.latencies.push_back(chrono_clock::now() - start);
+        result.bytes += length;
+      }
+      encryptor.Close();
+      result.duration = chrono_clock::now() - phase_start;
+      phases.emplace_back(name, std::move(result));
+    });
+
+    run_phase("write", offsets, [&](SelfEncryptor& encryptor, uint64_t offset, uint32_t length) {
+      if (!encryptor.Write(source.Data(offset), length, offset))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+    });
+
+    std::vector<char> buffer(piece_size);
+    run_phase("read", offsets, [&](SelfEncryptor& encryptor, uint64_t offset, uint32_t length) {
+      if (!encryptor.Read(&buffer[0], length, offset) ||
+          (options.verify && std::memcmp(&buffer[0], source.Data(offset), length) != 0)) {
+        LOG(kError) << "Read of " << length << " bytes at " << offset << " failed.";
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+      }
+    });
+
+    for (int cycle(1); cycle <= options.modify_cycles; ++cycle) {
+      std::vector<uint64_t> modified(offsets);
+      std::shuffle(std::begin(modified), std::end(modified), rng);
+      modified.resize(modified.size() * options.modify_percent / 100);
+      run_phase("modify", modified,
+                [&](SelfEncryptor& encryptor, uint64_t offset, uint32_t length) {
+        if (!encryptor.Write(source.Data(offset, cycle), length, offset))
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unknown));
+      });
+    }
+  }
+  boost::system::error_code error_code;
+  fs::remove_all(store_path, error_code);
+  return phases;
+}
+
+CaseResult RunCase(const Options& options, const DataSource& source, uint64_t file_size,
+                   uint32_t piece_size, AccessPattern pattern, int threads, Tracer* tracer) {
+  std::vector<std::future<std::vector<std::pair<std::string, PhaseResult>>>> futures;
+  for (int thread(0); thread != threads; ++thread) {
+    futures.emplace_back(std::async(std::launch::async, [&, thread] {
+      return RunThread(options, source, file_size, piece_size, pattern, thread, tracer);
+    }));
+  }
+  // Phases are combined across threads: bytes and latency samples are pooled, and the duration is
+  // that of the slowest thread.
+  CaseResult result{file_size, piece_size, pattern, threads, {}};
+  for (auto& future : futures) {
+    auto phases(future.get());
+    if (result.phases.empty()) {
+      result.phases = std::move(phases);
+      continue;
+    }
+    for (size_t i(0); i != phases.size(); ++i) {
+      PhaseResult& combined(result.phases[i].second);
+      combined.bytes += phases[i].second.bytes;
+      combined.duration = std::max(combined.duration, phases[i].second.duration);
+      combined.latencies.insert(std::end(combined.latencies),
+                                std::begin(phases[i].second.latencies),
+                                std::end(phases[i].second.latencies));
+    }
+  }
+  return result;
+}
+
+double Microseconds(chrono_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0;
+}
+
+void WriteJson(const std::vector<CaseResult>& results, std::ostream& output) {
+  output << "{\n  \"results\": [";
+  const char* separator("\n");
+  for (const auto& result : results) {
+    for (auto phase : result.phases) {
+      std::vector<chrono_clock::duration>& latencies(phase.second.latencies);
+      std::sort(std::begin(latencies), std::end(latencies));
+      auto percentile([&latencies](double fraction) {
+        if (latencies.empty())
+          return 0.0;
+        return Microseconds(latencies[static_cast<size_t>(fraction * (latencies.size() - 1))]);
+      });
+      double seconds(Microseconds(phase.second.duration) / 1000000.0);
+      output << separator << "    {\"file_size\": " << result.file_size
+             << ", \"piece_size\": " << result.piece_size << ", \"pattern\": \""
+             << ToString(result.pattern) << "\", \"threads\": " << result.threads
+             << ", \"phase\": \"" << phase.first << "\", \"bytes\": " << phase.second.bytes
+             << ", \"seconds\": " << seconds << ", \"bytes_per_second\": "
+             << (seconds > 0 ? phase.second.bytes / seconds : 0.0)
+             << ", \"calls\": " << latencies.size() << ", \"latency_us\": {\"p50\": "
+             << percentile(0.5) << ", \"p90\": " << percentile(0.9) << ", \"p99\": "
+             << percentile(0.99) << ", \"p999\": " << percentile(0.999)
+             << ", \"max\": " << percentile(1.0) << "}}";
+      separator = ",\n";
+    }
+  }
+  output << "\n  ]\n}\n";
+}
+
+}  // unnamed namespace
+
+int Run(int argc, char* argv[]) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  }
+  catch (const std::exception&) {
+    PrintUsage();
+    return 1;
+  }
+
+  DataSource source(*std::max_element(std::begin(options.piece_sizes),
+                                      std::end(options.piece_sizes)));
+  std::unique_ptr<Tracer> tracer(options.trace.empty() ? nullptr : new Tracer);
+  std::vector<CaseResult> results;
+  try {
+    for (uint64_t file_size : options.file_sizes) {
+      for (uint32_t piece_size : options.piece_sizes) {
+        for (AccessPattern pattern : options.patterns) {
+          for (int threads : options.thread_counts) {
+            std::cerr << "Running " << BytesToDecimalSiUnits(file_size) << " file, "
+                      << BytesToDecimalSiUnits(piece_size) << " pieces, " << ToString(pattern)
+                      << ", " << threads << " thread(s)\n";
+            results.push_back(
+                RunCase(options, source, file_size, piece_size, pattern, threads, tracer.get()));
+          }
+        }
+      }
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Benchmark failed: " << boost::diagnostic_information(e) << '\n';
+    return 2;
+  }
+
+  if (options.output.empty()) {
+    WriteJson(results, std::cout);
+  } else {
+    std::ofstream output(options.output);
+    WriteJson(results, output);
+  }
+  if (tracer) {
+    std::ofstream trace(options.trace);
+    tracer->WriteChromeTrace(trace);
+    if (tracer->dropped() != 0)
+      std::cerr << "Trace buffer full: " << tracer->dropped() << " spans dropped\n";
+  }
+  return 0;
+}
+
+}  // namespace benchmark
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+int main(int argc, char* argv[]) { return maidsafe::encrypt::benchmark::Run(argc, argv); }
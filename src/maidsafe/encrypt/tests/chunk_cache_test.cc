@@ -0,0 +1,139 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/chunk_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+// Names ending in the same byte share a shard.
+ByteVector Name(byte first, byte last) { return ByteVector{first, 1, 2, 3, last}; }
+
+ChunkCache::Chunk Chunk(size_t size, byte value) {
+  return std::make_shared<const ByteVector>(size, value);
+}
+
+}  // unnamed namespace
+
+TEST(ChunkCacheTest, BEH_EvictsLeastRecentlyUsed) {
+  // Each shard holds up to 3000 bytes.
+  ChunkCache cache(16 * 3000);
+  EXPECT_EQ(nullptr, cache.Get(Name(0, 0)));
+  cache.Put(Name(0, 0), Chunk(1000, 0));
+  cache.Put(Name(1, 0), Chunk(1000, 1));
+  cache.Put(Name(2, 0), Chunk(1000, 2));
+  cache.Put(Name(0, 1), Chunk(1000, 3));  // Another shard
+  EXPECT_EQ(4000U, cache.size());
+
+  // Using chunks 2 and 0 after 1 leaves 1 the least recently used in the full shard.
+  ChunkCache::Chunk held(cache.Get(Name(1, 0)));
+  ASSERT_NE(nullptr, cache.Get(Name(2, 0)));
+  ASSERT_NE(nullptr, cache.Get(Name(0, 0)));
+  EXPECT_EQ(0, cache.Get(Name(0, 0))->front());
+  cache.Put(Name(3, 0), Chunk(1000, 4));
+  EXPECT_EQ(nullptr, cache.Get(Name(1, 0)));
+  EXPECT_NE(nullptr, cache.Get(Name(0, 0)));
+  EXPECT_NE(nullptr, cache.Get(Name(2, 0)));
+  EXPECT_NE(nullptr, cache.Get(Name(3, 0)));
+  EXPECT_NE(nullptr, cache.Get(Name(0, 1)));
+  EXPECT_EQ(4000U, cache.size());
+  // An evicted chunk stays valid for as long as it's held.
+  EXPECT_EQ(ByteVector(1000, 1), *held);
+
+  // Putting a chunk that's already cached keeps the first copy.
+  cache.Put(Name(3, 0), Chunk(1000, 5));
+  EXPECT_EQ(4, cache.Get(Name(3, 0))->front());
+  EXPECT_EQ(4000U, cache.size());
+
+  // Too big for a shard, so never cached.
+  cache.Put(Name(4, 2), Chunk(3001, 6));
+  EXPECT_EQ(nullptr, cache.Get(Name(4, 2)));
+  EXPECT_EQ(4000U, cache.size());
+}
+
+TEST(ChunkCacheTest, BEH_ConcurrentGetAndPut) {
+  ChunkCache cache(16 * 10 * 100);
+  std::vector<std::future<void>> workers;
+  for (int i(0); i != 8; ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&cache, i] {
+      for (int j(0); j != 10000; ++j) {
+        ByteVector name(Name(static_cast<byte>(j % 50), static_cast<byte>((i + j) % 32)));
+        ChunkCache::Chunk chunk(cache.Get(name));
+        if (chunk)
+          EXPECT_EQ(name.front(), chunk->front());
+        else
+          cache.Put(name, Chunk(100, name.front()));
+      }
+    }));
+  }
+  for (auto& worker : workers)
+    worker.get();
+  EXPECT_LE(cache.size(), cache.capacity());
+}
+
+TEST(ChunkCacheTest, BEH_GetOrLoadLoadsOnce) {
+  ChunkCache cache(16 * 10 * 100);
+  std::atomic<int> loads(0);
+  auto slow_load([&loads] {
+    ++loads;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return Chunk(100, 7);
+  });
+  std::vector<std::future<ChunkCache::Chunk>> readers;
+  for (int i(0); i != 8; ++i) {
+    readers.emplace_back(std::async(std::launch::async, [&] {
+      return cache.GetOrLoad(Name(0, 0), slow_load);
+    }));
+  }
+  for (auto& reader : readers)
+    EXPECT_EQ(ByteVector(100, 7), *reader.get());
+  EXPECT_EQ(1, loads);
+  EXPECT_NE(nullptr, cache.Get(Name(0, 0)));
+
+  // A failed load is passed to its caller and nothing is cached, so the next caller loads afresh.
+  EXPECT_THROW(cache.GetOrLoad(Name(1, 0), []() -> ChunkCache::Chunk {
+    throw std::runtime_error("Missing");
+  }), std::runtime_error);
+  EXPECT_EQ(nullptr, cache.Get(Name(1, 0)));
+  EXPECT_EQ(ByteVector(100, 8), *cache.GetOrLoad(Name(1, 0), [] { return Chunk(100, 8); }));
+
+  // Too big to cache, but still returned.
+  EXPECT_EQ(ByteVector(1001, 9), *cache.GetOrLoad(Name(2, 0), [] { return Chunk(1001, 9); }));
+  EXPECT_EQ(nullptr, cache.Get(Name(2, 0)));
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,233 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Times each stage of the chunk crypto pipeline in isolation, then the whole of
+// SelfEncryptor::EncryptChunk and DecryptChunk, across a range of chunk sizes.  Cycle counts are
+// read from the time-stamp counter where available, so are reference rather than core cycles.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef WIN32
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/aes.h"
+#include "cryptopp/filters.h"
+#include "cryptopp/gzip.h"
+#include "cryptopp/modes.h"
+#include "cryptopp/sha.h"
+#ifdef WIN32
+#pragma warning(pop)
+#endif
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/data_buffer.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/chunk_status_table.h"
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/xor.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+uint64_t ReadCycleCounter() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+}  // unnamed namespace
+
+class ChunkPipelineBenchmark : public testing::Test {
+ public:
+  typedef std::chrono::high_resolution_clock clock;
+
+  ChunkPipelineBenchmark()
+      : kChunkSizes_({1024, 4096, 16384, 65536, 262144, 1048576, 4194304}),
+        kMinBytesPerStage_(16 * 1024 * 1024),
+        test_dir_(maidsafe::test::CreateTestPath()) {}
+
+ protected:
+  // Encrypts and decrypts chunks of each size with every stage, printing one row per stage.
+  void Run(bool compressible) {
+    std::cout << std::left << std::setw(16) << "Stage" << std::right << std::setw(10) << "Chunk"
+              << std::setw(16) << "Data" << std::setw(14) << "cycles/byte" << std::setw(10)
+              << "GB/s" << std::setw(14) << "ns/op" << '\n';
+    for (uint32_t chunk_size : kChunkSizes_) {
+      ByteVector data(CreateData(chunk_size, compressible));
+      RunStages(data, compressible);
+    }
+  }
+
+ private:
+  ByteVector CreateData(uint32_t size, bool compressible) {
+    std::string random(compressible ? RandomAlphaNumericString(256) : RandomString(size));
+    ByteVector data(size);
+    for (uint32_t i(0); i != size; ++i)
+      data[i] = static_cast<byte>(random[i % random.size()]);
+    return data;
+  }
+
+  // Calls |functor| repeatedly until at least kMinBytesPerStage_ have been processed and 100ms has
+  // passed, then prints the cost per byte and per call.  A |bytes_per_call| of 0 is for a stage
+  // whose cost doesn't depend on the chunk's data, so is only reported per call.
+  void Measure(const std::string& stage, uint32_t bytes_per_call, bool compressible,
+               const std::function<void()>& functor) {
+    functor();  // warm up
+    uint64_t calls(0);
+    const auto kStartTime(clock::now());
+    const uint64_t kStartCycles(ReadCycleCounter());
+    auto elapsed(clock::duration::zero());
+    do {
+      functor();
+      ++calls;
+      elapsed = clock::now() - kStartTime;
+    } while ((bytes_per_call != 0 && calls * bytes_per_call < kMinBytesPerStage_) ||
+             elapsed < std::chrono::milliseconds(100));
+    const uint64_t kCycles(ReadCycleCounter() - kStartCycles);
+    const double kNanoseconds(static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    const double kBytes(static_cast<double>(calls) * bytes_per_call);
+
+    std::cout << std::left << std::setw(16) << stage << std::right << std::setw(10)
+              << (bytes_per_call == 0 ? "-" : BytesToDecimalSiUnits(bytes_per_call))
+              << std::setw(16) << (compressible ? "compressible" : "incompressible") << std::fixed
+              << std::setprecision(2) << std::setw(14);
+    if (kCycles == 0 || bytes_per_call == 0)
+      std::cout << "n/a" << std::setw(10) << "n/a";
+    else
+      std::cout << kCycles / kBytes << std::setw(10) << kBytes / kNanoseconds;
+    std::cout << std::setw(14) << std::setprecision(0) << kNanoseconds / calls << '\n';
+  }
+
+  void RunStages(const ByteVector& data, bool compressible) {
+    const uint32_t kSize(static_cast<uint32_t>(data.size()));
+    const byte* const kInput(&data[0]);
+    DataBuffer<std::string> store(MemoryUsage(kSize * 4ULL + 1024 * 1024),
+                                  DiskUsage(4294967296),
+                                  [](const std::string& name, const NonEmptyString&) {
+                                    LOG(kError) << "Buffer full - deleting " << Base64Substr(name);
+                                    BOOST_THROW_EXCEPTION(
+                                        MakeError(CommonErrors::cannot_exceed_limit));
+                                  },
+                                  *test_dir_ / ("store_" + std::to_string(kSize)));
+    DataMap data_map;
+    SelfEncryptor encryptor(data_map, store,
+                            [&store](const std::string& name) { return store.Get(name); });
+    PrepareEncryptor(encryptor, kSize);
+
+    ByteVector key(crypto::AES256_KeySize), iv(crypto::AES256_IVSize), pad(kPadSize);
+    // Key derivation only reads the pre-hashes, so costs the same whatever the chunk's size.
+    Measure("GetPadIvKey", 0, compressible, [&] { encryptor.GetPadIvKey(0, key, iv, pad); });
+
+    std::string output;
+    output.reserve(kSize + kSize / 8 + 1024);
+    Measure("SHA512", kSize, compressible, [&] {
+      output.resize(crypto::SHA512::DIGESTSIZE);
+      CryptoPP::SHA512().CalculateDigest(reinterpret_cast<byte*>(&output[0]), kInput, kSize);
+    });
+
+    Measure("Gzip", kSize, compressible, [&] {
+      output.clear();
+      CryptoPP::Gzip gzip(new CryptoPP::StringSink(output), 1);
+      gzip.Put2(kInput, kSize, -1, true);
+    });
+    const std::string kCompressed(output);
+    Measure("Gunzip", kSize, compressible, [&] {
+      output.clear();
+      CryptoPP::Gunzip gunzip(new CryptoPP::StringSink(output));
+      gunzip.Put2(reinterpret_cast<const byte*>(kCompressed.data()), kCompressed.size(), -1,
+                  true);
+    });
+
+    Measure("AES-256-CFB", kSize, compressible, [&] {
+      output.clear();
+      CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(&key[0], crypto::AES256_KeySize,
+                                                              &iv[0]);
+      CryptoPP::StreamTransformationFilter filter(encryptor, new CryptoPP::StringSink(output));
+      filter.Put2(kInput, kSize, -1, true);
+    });
+
+    Measure("XORFilter", kSize, compressible, [&] {
+      output.clear();
+      XORFilter filter(new CryptoPP::StringSink(output), &pad[0]);
+      filter.Put2(kInput, kSize, -1, true);
+    });
+
+    Measure("EncryptChunk", kSize, compressible, [&] {
+      encryptor.EncryptChunk(0, data.data(), kSize);
+      const ByteVector& name(encryptor.data_map_.chunks[0].hash);
+      store.Delete(std::string(std::begin(name), std::end(name)));
+    });
+
+    encryptor.EncryptChunk(0, data.data(), kSize);
+    Measure("DecryptChunk", kSize, compressible, [&] { encryptor.DecryptChunk(0); });
+    EXPECT_EQ(data, encryptor.DecryptChunk(0));
+    encryptor.closed_ = true;
+  }
+
+  // Gives the encryptor three chunks with random pre-hashes, so that each chunk's key, IV and pad
+  // can be derived without having written any data.
+  void PrepareEncryptor(SelfEncryptor& encryptor, uint32_t chunk_size) {
+    encryptor.file_size_ = 3 * kMinChunkSize;
+    encryptor.data_map_.chunks.resize(3);
+    for (uint32_t i(0); i != 3; ++i) {
+      std::string pre_hash(RandomString(crypto::SHA512::DIGESTSIZE));
+      encryptor.data_map_.chunks[i].pre_hash.assign(std::begin(pre_hash), std::end(pre_hash));
+      encryptor.data_map_.chunks[i].size = chunk_size;
+      encryptor.chunks_->Set(i, SelfEncryptor::ChunkStatus::stored);
+    }
+  }
+
+  const std::vector<uint32_t> kChunkSizes_;
+  const uint64_t kMinBytesPerStage_;
+  maidsafe::test::TestPath test_dir_;
+};
+
+TEST_F(ChunkPipelineBenchmark, FUNC_Compressible) { Run(true); }
+
+TEST_F(ChunkPipelineBenchmark, FUNC_Incompressible) { Run(false); }
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
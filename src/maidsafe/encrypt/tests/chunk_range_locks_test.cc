@@ -0,0 +1,93 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/chunk_range_locks.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+TEST(ChunkRangeLocksTest, BEH_OverlappingRangesExclude) {
+  ChunkRangeLocks locks;
+  std::atomic<bool> locked(false);
+  std::future<void> waiter;
+  {
+    ChunkRangeLocks::Guard held(locks, 10, 20, true);
+    // Disjoint ranges, and empty ones, don't wait.
+    ChunkRangeLocks::Guard before(locks, 0, 10, true);
+    ChunkRangeLocks::Guard after(locks, 20, 30, false);
+    ChunkRangeLocks::Guard empty(locks, 15, 15, true);
+
+    waiter = std::async(std::launch::async, [&] {
+      ChunkRangeLocks::Guard overlapping(locks, 19, 21, false);
+      locked = true;
+    });
+    EXPECT_EQ(std::future_status::timeout, waiter.wait_for(std::chrono::milliseconds(100)));
+    EXPECT_FALSE(locked);
+  }
+  // Once the exclusive range is released, the waiter gets its lock.
+  waiter.get();
+  EXPECT_TRUE(locked);
+}
+
+TEST(ChunkRangeLocksTest, BEH_SharedRangesOverlap) {
+  ChunkRangeLocks locks;
+  ChunkRangeLocks::Guard first(locks, 0, 10, false);
+  auto second(std::async(std::launch::async, [&] {
+    ChunkRangeLocks::Guard overlapping(locks, 5, 15, false);
+  }));
+  EXPECT_EQ(std::future_status::ready, second.wait_for(std::chrono::seconds(10)));
+}
+
+TEST(ChunkRangeLocksTest, BEH_ExclusiveRangesSerialise) {
+  ChunkRangeLocks locks;
+  std::vector<int> counts(8, 0);
+  std::vector<std::future<void>> workers;
+  for (uint32_t i(0); i != 8; ++i) {
+    workers.emplace_back(std::async(std::launch::async, [&, i] {
+      for (uint32_t j(0); j != 10000; ++j) {
+        // Each range overlaps its neighbours', so unlocked increments would race.
+        uint32_t first((i + j) % 7);
+        ChunkRangeLocks::Guard range(locks, first, first + 2, true);
+        ++counts[first];
+        ++counts[first + 1];
+      }
+    }));
+  }
+  for (auto& worker : workers)
+    worker.get();
+  int total(0);
+  for (int count : counts)
+    total += count;
+  EXPECT_EQ(8 * 10000 * 2, total);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,93 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/chunk_status_table.h"
+
+#include <future>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+enum class Status : uint8_t { kA, kB, kNone };
+
+}  // unnamed namespace
+
+TEST(ChunkStatusTableTest, BEH_SetGetAndResize) {
+  ChunkStatusTable<Status> table(Status::kNone);
+  EXPECT_EQ(0U, table.size());
+  EXPECT_EQ(Status::kNone, table.Get(7));
+
+  table.Set(7, Status::kA);
+  EXPECT_EQ(8U, table.size());
+  EXPECT_EQ(Status::kA, table.Get(7));
+  for (uint32_t i(0); i != 7; ++i)
+    EXPECT_EQ(Status::kNone, table.Get(i)) << i;
+
+  // Growing keeps existing statuses; shrinking then growing again doesn't bring them back.
+  table.Set(2, Status::kB);
+  table.Resize(1000);
+  EXPECT_EQ(Status::kB, table.Get(2));
+  EXPECT_EQ(Status::kA, table.Get(7));
+  EXPECT_EQ(Status::kNone, table.Get(999));
+  table.Resize(5);
+  EXPECT_EQ(Status::kB, table.Get(2));
+  EXPECT_EQ(Status::kNone, table.Get(7));
+  table.Resize(8);
+  EXPECT_EQ(Status::kNone, table.Get(7));
+  table.Clear();
+  EXPECT_EQ(0U, table.size());
+  EXPECT_EQ(Status::kNone, table.Get(2));
+
+  // Reserving keeps the size and statuses.
+  table.Set(3, Status::kA);
+  table.Reserve(2000);
+  EXPECT_EQ(4U, table.size());
+  EXPECT_EQ(Status::kA, table.Get(3));
+  EXPECT_EQ(Status::kNone, table.Get(1999));
+}
+
+TEST(ChunkStatusTableTest, BEH_ConcurrentUpdates) {
+  const uint32_t kChunks(100000), kThreads(8);
+  ChunkStatusTable<Status> table(Status::kNone);
+  table.Resize(kChunks);
+  std::vector<std::future<void>> futures;
+  for (uint32_t thread(0); thread != kThreads; ++thread) {
+    futures.emplace_back(std::async(std::launch::async, [&table, thread, kChunks, kThreads] {
+      for (uint32_t i(thread); i < kChunks; i += kThreads)
+        table.Set(i, i % 2 ? Status::kA : Status::kB);
+    }));
+  }
+  for (auto& future : futures)
+    future.get();
+  for (uint32_t i(0); i != kChunks; ++i)
+    ASSERT_EQ(i % 2 ? Status::kA : Status::kB, table.Get(i)) << i;
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -19,6 +19,7 @@
 #include <thread>
 #include <array>
 #include <cstdlib>
+#include <sstream>
 #include <string>
 
 #ifdef WIN32
@@ -30,6 +31,7 @@
 #include "cryptopp/ida.h"
 #include "cryptopp/modes.h"
 #include "cryptopp/mqueue.h"
+#include "cryptopp/sha.h"
 #ifdef WIN32
 #pragma warning(pop)
 #endif
@@ -44,6 +46,7 @@
 #include "maidsafe/encrypt/self_encryptor.h"
 #include "maidsafe/encrypt/data_map_encryptor.h"
 #include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/data_map.pb.h"
 #include "maidsafe/encrypt/tests/encrypt_test_base.h"
 
 namespace fs = boost::filesystem;
@@ -58,6 +61,36 @@ namespace {
 
 typedef std::pair<uint32_t, uint32_t> SizeAndOffset;
 const int g_num_procs(Concurrency());
+
+// Encrypts |data_map| as kDataMapEncryptionVersion0 did, i.e. without compressing it first.
+std::string EncryptDataMapVersion0(const Identity& parent_id, const Identity& this_id,
+                                   const DataMap& data_map) {
+  std::string serialised_data_map;
+  SerialiseDataMap(data_map, serialised_data_map);
+  const std::string kEncInput(parent_id.string() + this_id.string());
+  const std::string kXorInput(this_id.string() + parent_id.string());
+  ByteVector enc_hash(crypto::SHA512::DIGESTSIZE), xor_hash(crypto::SHA512::DIGESTSIZE);
+  CryptoPP::SHA512().CalculateDigest(&enc_hash[0], reinterpret_cast<const byte*>(kEncInput.data()),
+                                     kEncInput.size());
+  CryptoPP::SHA512().CalculateDigest(&xor_hash[0], reinterpret_cast<const byte*>(kXorInput.data()),
+                                     kXorInput.size());
+
+  CryptoPP::CFB_Mode<CryptoPP::AES>::Encryption encryptor(&enc_hash[0], crypto::AES256_KeySize,
+                                                          &enc_hash[crypto::AES256_KeySize]);
+  std::string contents(serialised_data_map.size(), 0);
+  encryptor.ProcessData(reinterpret_cast<byte*>(&contents[0]),
+                        reinterpret_cast<const byte*>(serialised_data_map.data()),
+                        serialised_data_map.size());
+  for (size_t i(0); i != contents.size(); ++i)
+    contents[i] ^= xor_hash[i % crypto::SHA512::DIGESTSIZE];
+
+  protobuf::EncryptedDataMap encrypted_data_map;
+  encrypted_data_map.set_data_map_encryption_version(
+      static_cast<uint32_t>(EncryptionAlgorithm::kDataMapEncryptionVersion0));
+  encrypted_data_map.set_contents(contents);
+  return encrypted_data_map.SerializeAsString();
+}
+
 }  // unnamed namespace
 
 class EncryptDataMapTest : public EncryptTestBase, public testing::Test {
@@ -158,6 +191,109 @@ TEST_F(EncryptDataMapTest, BEH_DifferentDataMapSameChunk) {
   EXPECT_NO_THROW(self_encryptor_->Close());
 }
 
+TEST(StreamingDataMapTest, BEH_StreamDecryptsWithEncryptDataMap) {
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  DataMap data_map(CreateSyntheticDataMap(100));
+  std::ostringstream sink;
+  EncryptDataMap(kParentId, kThisId, data_map, sink);
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, sink.str()));
+
+  DataMap small_data_map;
+  std::string content(RandomString(100));
+  small_data_map.content.assign(std::begin(content), std::end(content));
+  std::ostringstream small_sink;
+  EncryptDataMap(kParentId, kThisId, small_data_map, small_sink);
+  EXPECT_EQ(small_data_map, DecryptDataMap(kParentId, kThisId, small_sink.str()));
+}
+
+TEST(StreamingDataMapTest, BEH_StreamRoundTrip) {
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  DataMap data_map(CreateSyntheticDataMap(1000));
+  data_map.chunks[10].storage_state = ChunkDetails::kPending;
+  data_map.chunks[20].size = kMinChunkSize;
+  std::stringstream stream;
+  EncryptDataMap(kParentId, kThisId, data_map, stream);
+
+  DataMap retrieved_data_map(DecryptDataMap(kParentId, kThisId, stream));
+  EXPECT_EQ(data_map, retrieved_data_map);
+  ASSERT_EQ(data_map.chunks.size(), retrieved_data_map.chunks.size());
+  for (size_t i(0); i != data_map.chunks.size(); ++i) {
+    EXPECT_EQ(data_map.chunks[i].pre_hash, retrieved_data_map.chunks[i].pre_hash);
+    EXPECT_EQ(data_map.chunks[i].size, retrieved_data_map.chunks[i].size);
+    EXPECT_EQ(data_map.chunks[i].storage_state, retrieved_data_map.chunks[i].storage_state);
+  }
+
+  // Stream and non-stream forms are interchangeable
+  std::istringstream source(EncryptDataMap(kParentId, kThisId, data_map).string());
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, source));
+  std::ostringstream sink;
+  EncryptDataMap(kParentId, kThisId, data_map, sink);
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, sink.str()));
+}
+
+TEST(StreamingDataMapTest, BEH_StreamTruncated) {
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  std::ostringstream sink;
+  EncryptDataMap(kParentId, kThisId, CreateSyntheticDataMap(10), sink);
+  std::istringstream truncated(sink.str().substr(0, sink.str().size() - 1));
+  EXPECT_THROW(DecryptDataMap(kParentId, kThisId, truncated), common_error);
+  std::istringstream empty;
+  EXPECT_THROW(DecryptDataMap(kParentId, kThisId, empty), common_error);
+}
+
+TEST(DataMapVersionTest, BEH_CompressesBeforeEncrypting) {
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  DataMap data_map;
+  const std::string kText("The quick brown fox jumps over the lazy dog.\n");
+  for (int i(0); i != 60; ++i)
+    data_map.content.insert(std::end(data_map.content), std::begin(kText), std::end(kText));
+  std::string serialised_data_map;
+  SerialiseDataMap(data_map, serialised_data_map);
+
+  crypto::CipherText encrypted(EncryptDataMap(kParentId, kThisId, data_map));
+  EXPECT_LT(encrypted.string().size(), serialised_data_map.size() / 4);
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, encrypted.string()));
+}
+
+TEST(DataMapVersionTest, BEH_DecryptVersion0) {
+  const Identity kParentId(RandomString(64)), kThisId(RandomString(64));
+  DataMap data_map(CreateSyntheticDataMap(100));
+  std::string encrypted(EncryptDataMapVersion0(kParentId, kThisId, data_map));
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, encrypted));
+  std::istringstream source(encrypted);
+  EXPECT_EQ(data_map, DecryptDataMap(kParentId, kThisId, source));
+
+  DataMap small_data_map;
+  std::string content(RandomString(100));
+  small_data_map.content.assign(std::begin(content), std::end(content));
+  EXPECT_EQ(small_data_map,
+            DecryptDataMap(kParentId, kThisId,
+                           EncryptDataMapVersion0(kParentId, kThisId, small_data_map)));
+}
+
+TEST(BatchDataMapTest, BEH_BatchMatchesSingle) {
+  const Identity kParentId(RandomString(64));
+  EXPECT_TRUE(EncryptDataMaps(kParentId, std::vector<std::pair<Identity, DataMap>>()).empty());
+
+  std::vector<std::pair<Identity, DataMap>> data_maps;
+  for (uint32_t i(0); i != 50; ++i)
+    data_maps.emplace_back(Identity(RandomString(64)), CreateSyntheticDataMap(3 + i));
+  std::vector<crypto::CipherText> encrypted(EncryptDataMaps(kParentId, data_maps));
+  ASSERT_EQ(data_maps.size(), encrypted.size());
+
+  std::vector<std::pair<Identity, std::string>> encrypted_data_maps;
+  for (size_t i(0); i != data_maps.size(); ++i) {
+    EXPECT_EQ(EncryptDataMap(kParentId, data_maps[i].first, data_maps[i].second).string(),
+              encrypted[i].string());
+    encrypted_data_maps.emplace_back(data_maps[i].first, encrypted[i].string());
+  }
+
+  std::vector<DataMap> decrypted(DecryptDataMaps(kParentId, encrypted_data_maps));
+  ASSERT_EQ(data_maps.size(), decrypted.size());
+  for (size_t i(0); i != data_maps.size(); ++i)
+    EXPECT_EQ(data_maps[i].second, decrypted[i]);
+}
+
 }  // namespace test
 
 }  // namespace encrypt
@@ -0,0 +1,160 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/data_map_patch.h"
+
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/merkle_tree.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+DataMap RoundTrip(const DataMap& old_data_map, const DataMap& new_data_map) {
+  std::string serialised_patch;
+  SerialiseDataMapPatch(DiffDataMaps(old_data_map, new_data_map), serialised_patch);
+  DataMapPatch patch;
+  ParseDataMapPatch(serialised_patch, patch);
+  DataMap patched(old_data_map);
+  ApplyPatch(patch, patched);
+  return patched;
+}
+
+void ExpectIdentical(const DataMap& expected, const DataMap& actual) {
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(expected.merkle_root, actual.merkle_root);
+  ASSERT_EQ(expected.chunks.size(), actual.chunks.size());
+  for (size_t i(0); i != expected.chunks.size(); ++i) {
+    EXPECT_EQ(expected.chunks[i].pre_hash, actual.chunks[i].pre_hash) << i;
+    EXPECT_EQ(expected.chunks[i].size, actual.chunks[i].size) << i;
+    EXPECT_EQ(expected.chunks[i].storage_state, actual.chunks[i].storage_state) << i;
+  }
+}
+
+}  // unnamed namespace
+
+TEST(DataMapPatchTest, BEH_IdenticalMaps) {
+  DataMap data_map(CreateSyntheticDataMap(1000));
+  DataMapPatch patch(DiffDataMaps(data_map, data_map));
+  EXPECT_EQ(1000U, patch.base_num_chunks);
+  EXPECT_EQ(1000U, patch.num_chunks);
+  EXPECT_TRUE(patch.changed_chunks.empty());
+  ExpectIdentical(data_map, RoundTrip(data_map, data_map));
+}
+
+TEST(DataMapPatchTest, BEH_ChangedChunks) {
+  const uint32_t kNumChunks(1000);
+  DataMap old_data_map(CreateSyntheticDataMap(kNumChunks)), new_data_map(old_data_map);
+  new_data_map.chunks[500].hash.assign(64, 1);
+  new_data_map.chunks[501].pre_hash.assign(64, 2);
+  new_data_map.chunks[999].size = 10;
+  new_data_map.chunks[0].storage_state = ChunkDetails::kPending;
+  new_data_map.merkle_root.assign(64, 3);
+
+  DataMapPatch patch(DiffDataMaps(old_data_map, new_data_map));
+  ASSERT_EQ(4U, patch.changed_chunks.size());
+  EXPECT_EQ(0U, patch.changed_chunks[0].first);
+  EXPECT_EQ(500U, patch.changed_chunks[1].first);
+  EXPECT_EQ(501U, patch.changed_chunks[2].first);
+  EXPECT_EQ(999U, patch.changed_chunks[3].first);
+  ExpectIdentical(new_data_map, RoundTrip(old_data_map, new_data_map));
+
+  std::string serialised_patch, serialised_data_map;
+  SerialiseDataMapPatch(patch, serialised_patch);
+  SerialiseDataMap(new_data_map, serialised_data_map);
+  EXPECT_LT(serialised_patch.size() * 100, serialised_data_map.size());
+}
+
+TEST(DataMapPatchTest, BEH_ChangedSize) {
+  DataMap original(CreateSyntheticDataMap(100)), extended(original), truncated(original);
+  extended.chunks.resize(150, original.chunks[1]);
+  truncated.chunks.resize(40);
+  truncated.chunks[39].size = 1;
+
+  DataMapPatch patch(DiffDataMaps(original, extended));
+  EXPECT_EQ(50U, patch.changed_chunks.size());
+  ExpectIdentical(extended, RoundTrip(original, extended));
+  ExpectIdentical(original, RoundTrip(extended, original));
+
+  patch = DiffDataMaps(original, truncated);
+  ASSERT_EQ(1U, patch.changed_chunks.size());
+  EXPECT_EQ(39U, patch.changed_chunks[0].first);
+  ExpectIdentical(truncated, RoundTrip(original, truncated));
+
+  DataMap small;
+  small.content.assign(100, 'a');
+  ExpectIdentical(small, RoundTrip(original, small));
+  ExpectIdentical(original, RoundTrip(small, original));
+}
+
+TEST(DataMapPatchTest, BEH_InvalidPatch) {
+  DataMap original(CreateSyntheticDataMap(10)), modified(original);
+  modified.chunks.resize(12, original.chunks[0]);
+  DataMapPatch patch(DiffDataMaps(original, modified));
+
+  DataMap wrong_base(CreateSyntheticDataMap(11));
+  EXPECT_THROW(ApplyPatch(patch, wrong_base), common_error);
+  EXPECT_EQ(11U, wrong_base.chunks.size());
+  // The same size as the base, but with different chunks.
+  wrong_base = CreateSyntheticDataMap(10);
+  const DataMap kWrongBase(wrong_base);
+  EXPECT_THROW(ApplyPatch(patch, wrong_base), common_error);
+  ExpectIdentical(kWrongBase, wrong_base);
+  // Differing only in a chunk's storage state.
+  wrong_base = original;
+  wrong_base.chunks[4].storage_state = ChunkDetails::kUnstored;
+  EXPECT_THROW(ApplyPatch(patch, wrong_base), common_error);
+  // Or, where the bases have Merkle roots, in those.
+  DataMap rooted(original);
+  rooted.merkle_root = MerkleTree(rooted).root();
+  DataMapPatch rooted_patch(DiffDataMaps(rooted, modified));
+  wrong_base = kWrongBase;
+  wrong_base.merkle_root = MerkleTree(wrong_base).root();
+  EXPECT_THROW(ApplyPatch(rooted_patch, wrong_base), common_error);
+  EXPECT_NO_THROW(ApplyPatch(rooted_patch, rooted));
+
+  DataMapPatch missing_chunk(patch);
+  missing_chunk.changed_chunks.pop_back();
+  DataMap data_map(original);
+  EXPECT_THROW(ApplyPatch(missing_chunk, data_map), common_error);
+  ExpectIdentical(original, data_map);
+
+  DataMapPatch out_of_range(patch);
+  out_of_range.changed_chunks.back().first = 12;
+  EXPECT_THROW(ApplyPatch(out_of_range, data_map), common_error);
+  ExpectIdentical(original, data_map);
+
+  EXPECT_THROW(ParseDataMapPatch(RandomString(100), patch), common_error);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
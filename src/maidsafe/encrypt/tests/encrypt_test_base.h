@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ENCRYPT_TESTS_ENCRYPT_TEST_BASE_H_
 #define MAIDSAFE_ENCRYPT_TESTS_ENCRYPT_TEST_BASE_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <thread>
@@ -34,6 +35,24 @@ namespace encrypt {
 
 namespace test {
 
+// Builds a data map of |num_chunks| full-size chunks with random-looking hashes, without touching a
+// store.  Hashes are cut from a shared random pool so that very large maps are cheap to create.
+inline DataMap CreateSyntheticDataMap(uint32_t num_chunks) {
+  const size_t kPoolSize(64 * 1024);
+  const std::string kPool(RandomString(kPoolSize + crypto::SHA512::DIGESTSIZE));
+  DataMap data_map;
+  data_map.chunks.resize(num_chunks);
+  for (uint32_t i(0); i != num_chunks; ++i) {
+    auto hash_itr(std::begin(kPool) + ((i * 2 * 37) % kPoolSize));
+    auto pre_hash_itr(std::begin(kPool) + (((i * 2 + 1) * 37) % kPoolSize));
+    data_map.chunks[i].hash.assign(hash_itr, hash_itr + crypto::SHA512::DIGESTSIZE);
+    data_map.chunks[i].pre_hash.assign(pre_hash_itr, pre_hash_itr + crypto::SHA512::DIGESTSIZE);
+    data_map.chunks[i].size = kMaxChunkSize;
+    data_map.chunks[i].storage_state = ChunkDetails::kStored;
+  }
+  return data_map;
+}
+
 class EncryptTestBase {
  public:
   explicit EncryptTestBase()
@@ -0,0 +1,148 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/merkle_tree.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/data_map_encryptor.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> Ranges;
+
+void ChangeChunk(DataMap& data_map, uint32_t index) {
+  ByteVector& hash(data_map.chunks[index].hash);
+  hash[0] = static_cast<byte>(hash[0] + 1);
+}
+
+}  // unnamed namespace
+
+TEST(MerkleTreeTest, BEH_EmptyDataMap) {
+  MerkleTree tree((DataMap()));
+  EXPECT_TRUE(tree.root().empty());
+  EXPECT_EQ(0U, tree.num_leaves());
+  EXPECT_THROW(tree.InclusionProof(0), common_error);
+}
+
+TEST(MerkleTreeTest, BEH_InclusionProof) {
+  for (uint32_t num_chunks : {1U, 3U, 5U, 8U, 1000U}) {
+    DataMap data_map(CreateSyntheticDataMap(num_chunks));
+    MerkleTree tree(data_map);
+    ByteVector root(tree.root());
+    ASSERT_EQ(crypto::SHA512::DIGESTSIZE, root.size());
+    EXPECT_EQ(root, MerkleTree(data_map).root());
+    for (uint32_t i(0); i != num_chunks; ++i) {
+      std::vector<ByteVector> proof(tree.InclusionProof(i));
+      EXPECT_TRUE(MerkleTree::VerifyInclusionProof(root, data_map.chunks[i].hash, i, proof)) << i;
+      if (num_chunks > 1) {
+        EXPECT_FALSE(MerkleTree::VerifyInclusionProof(root, data_map.chunks[i].hash,
+                                                      (i + 1) % num_chunks, proof)) << i;
+        EXPECT_FALSE(MerkleTree::VerifyInclusionProof(
+            root, data_map.chunks[(i + 1) % num_chunks].hash, i, proof)) << i;
+      }
+      if (!proof.empty()) {
+        proof.back()[0] = static_cast<byte>(proof.back()[0] + 1);
+        EXPECT_FALSE(MerkleTree::VerifyInclusionProof(root, data_map.chunks[i].hash, i, proof));
+      }
+    }
+    EXPECT_THROW(tree.InclusionProof(num_chunks), common_error);
+  }
+}
+
+TEST(MerkleTreeTest, BEH_ChangedChunkRanges) {
+  const uint32_t kNumChunks(100);
+  DataMap original(CreateSyntheticDataMap(kNumChunks)), modified(original);
+  MerkleTree original_tree(original);
+  EXPECT_TRUE(ChangedChunkRanges(original_tree, MerkleTree(modified)).empty());
+
+  ChangeChunk(modified, 42);
+  EXPECT_NE(original_tree.root(), MerkleTree(modified).root());
+  EXPECT_EQ(Ranges(1, std::make_pair(42U, 43U)),
+            ChangedChunkRanges(original_tree, MerkleTree(modified)));
+
+  ChangeChunk(modified, 43);
+  ChangeChunk(modified, 0);
+  ChangeChunk(modified, 99);
+  Ranges expected;
+  expected.emplace_back(0, 1);
+  expected.emplace_back(42, 44);
+  expected.emplace_back(99, 100);
+  EXPECT_EQ(expected, ChangedChunkRanges(original_tree, MerkleTree(modified)));
+  EXPECT_EQ(expected, ChangedChunkRanges(MerkleTree(modified), original_tree));
+}
+
+TEST(MerkleTreeTest, BEH_ChangedChunkRangesDifferentLengths) {
+  DataMap original(CreateSyntheticDataMap(100)), extended(original), truncated(original);
+  extended.chunks.resize(300, original.chunks[0]);
+  truncated.chunks.resize(60);
+  MerkleTree original_tree(original);
+  EXPECT_EQ(Ranges(1, std::make_pair(100U, 300U)),
+            ChangedChunkRanges(original_tree, MerkleTree(extended)));
+  EXPECT_EQ(Ranges(1, std::make_pair(60U, 100U)),
+            ChangedChunkRanges(MerkleTree(truncated), original_tree));
+
+  ChangeChunk(extended, 10);
+  Ranges expected;
+  expected.emplace_back(10, 11);
+  expected.emplace_back(100, 300);
+  EXPECT_EQ(expected, ChangedChunkRanges(original_tree, MerkleTree(extended)));
+  EXPECT_EQ(Ranges(1, std::make_pair(0U, 100U)),
+            ChangedChunkRanges(MerkleTree(DataMap()), original_tree));
+}
+
+TEST(MerkleTreeTest, BEH_RootStoredInDataMap) {
+  DataMap data_map(CreateSyntheticDataMap(10));
+  data_map.merkle_root = MerkleTree(data_map).root();
+
+  std::string serialised;
+  SerialiseDataMap(data_map, serialised);
+  DataMap parsed;
+  ParseDataMap(serialised, parsed);
+  EXPECT_EQ(data_map.merkle_root, parsed.merkle_root);
+
+  Identity parent_id(RandomString(64)), this_id(RandomString(64));
+  std::stringstream stream;
+  EncryptDataMap(parent_id, this_id, data_map, stream);
+  EXPECT_EQ(data_map.merkle_root, DecryptDataMap(parent_id, this_id, stream).merkle_root);
+  crypto::CipherText encrypted(EncryptDataMap(parent_id, this_id, data_map));
+  EXPECT_EQ(data_map.merkle_root,
+            DecryptDataMap(parent_id, this_id, encrypted.string()).merkle_root);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,164 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_TESTS_PERF_COUNTERS_H_
+#define MAIDSAFE_ENCRYPT_TESTS_PERF_COUNTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+// Hardware counters around a measured phase, read through perf_event_open on Linux.  Counting is
+// off unless the MAIDSAFE_PERF_COUNTERS environment variable is set, and each counter that can't
+// be opened (no PMU, a VM, or perf_event_paranoid too strict) is simply reported as unavailable.
+// Threads started while counting, such as SelfEncryptor's encryption tasks, are included.
+class PerfCounters {
+ public:
+  enum Event { kCycles, kInstructions, kCacheMisses, kBranchMisses, kEventCount };
+
+  PerfCounters() : file_descriptors_(), values_() {
+    file_descriptors_.fill(-1);
+    values_.fill(0);
+#ifdef __linux__
+    if (!std::getenv("MAIDSAFE_PERF_COUNTERS"))
+      return;
+    const uint64_t kConfigs[kEventCount] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                            PERF_COUNT_HW_CACHE_MISSES,
+                                            PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i(0); i != kEventCount; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = kConfigs[i];
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      file_descriptors_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+      if (file_descriptors_[i] == -1)
+        LOG(kInfo) << "Hardware counter " << Name(static_cast<Event>(i)) << " unavailable.";
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (int file_descriptor : file_descriptors_) {
+      if (file_descriptor != -1)
+        close(file_descriptor);
+    }
+#endif
+  }
+
+  bool available() const {
+    for (int file_descriptor : file_descriptors_) {
+      if (file_descriptor != -1)
+        return true;
+    }
+    return false;
+  }
+
+  void Start() {
+#ifdef __linux__
+    for (int file_descriptor : file_descriptors_) {
+      if (file_descriptor != -1) {
+        ioctl(file_descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(file_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  void Stop() {
+    values_.fill(0);
+#ifdef __linux__
+    for (int i(0); i != kEventCount; ++i) {
+      if (file_descriptors_[i] == -1)
+        continue;
+      ioctl(file_descriptors_[i], PERF_EVENT_IOC_DISABLE, 0);
+      // value, time enabled, time running: scale up if the counter was multiplexed.
+      uint64_t reading[3] = {0, 0, 0};
+      if (read(file_descriptors_[i], reading, sizeof(reading)) == sizeof(reading) &&
+          reading[2] != 0) {
+        values_[i] = static_cast<uint64_t>(static_cast<double>(reading[0]) * reading[1] /
+                                           reading[2]);
+      }
+    }
+#endif
+  }
+
+  // Zero if the counter is unavailable.
+  uint64_t value(Event event) const { return values_[event]; }
+
+  // E.g. "cycles/B 3.10, instructions/B 9.52, cache-misses/B 0.0041, branch-misses/B n/a", or an
+  // empty string if no counters are available.
+  std::string PerByte(uint64_t bytes) const {
+    if (!available() || bytes == 0)
+      return std::string();
+    std::ostringstream report;
+    for (int i(0); i != kEventCount; ++i) {
+      report << (i ? ", " : "") << Name(static_cast<Event>(i)) << "/B ";
+      if (file_descriptors_[i] == -1)
+        report << "n/a";
+      else
+        report << static_cast<double>(values_[i]) / bytes;
+    }
+    return report.str();
+  }
+
+  static const char* Name(Event event) {
+    const char* const kNames[kEventCount] = {"cycles", "instructions", "cache-misses",
+                                             "branch-misses"};
+    return kNames[event];
+  }
+
+ private:
+  std::array<int, kEventCount> file_descriptors_;
+  std::array<uint64_t, kEventCount> values_;
+};
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_TESTS_PERF_COUNTERS_H_
@@ -0,0 +1,200 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Replays recorded SelfEncryptor workloads and reports the latency distribution of each type of
+// call, so that real traces can be used to catch performance regressions.
+//
+// Usage: replay_workload_encrypt <trace file>...
+//        replay_workload_encrypt --import <transcribed test source> <trace file>
+//
+// --import converts calls of the form "self_encryptor_->Write(data, length, position)" (and Read,
+// Truncate, Flush and Close), as in massive_self_encryptor_test.xx, into a binary trace.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/exception/all.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/data_buffer.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/workload_trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace benchmark {
+
+namespace {
+
+const char* const kOperationNames[] = {"Write", "Read", "Truncate", "Flush", "Close"};
+
+// Parses the integer arguments of a call such as "Write(data.c_str(), 4096, 8192)".
+std::vector<uint64_t> IntegerArguments(const std::string& arguments) {
+  std::vector<uint64_t> integers;
+  std::istringstream stream(arguments);
+  std::string argument;
+  while (std::getline(stream, argument, ',')) {
+    argument.erase(std::remove(std::begin(argument), std::end(argument), ' '), std::end(argument));
+    if (!argument.empty() &&
+        std::all_of(std::begin(argument), std::end(argument), [](char c) { return isdigit(c); })) {
+      integers.push_back(std::stoull(argument));
+    }
+  }
+  return integers;
+}
+
+std::vector<WorkloadOperation> ImportTranscribedTest(std::istream& source) {
+  const std::string kCall("self_encryptor_->");
+  std::vector<WorkloadOperation> operations;
+  std::string line;
+  while (std::getline(source, line)) {
+    size_t start(line.find_first_not_of(" \t"));
+    if (start == std::string::npos || line.compare(start, 2, "//") == 0)
+      continue;
+    size_t call(line.find(kCall));
+    if (call == std::string::npos)
+      continue;
+    size_t open(line.find('(', call)), close(line.rfind(')'));
+    if (open == std::string::npos || close == std::string::npos || close < open)
+      continue;
+    std::string name(line.substr(call + kCall.size(), open - call - kCall.size()));
+    std::vector<uint64_t> arguments(IntegerArguments(line.substr(open + 1, close - open - 1)));
+    if (name == "Write" && arguments.size() == 2) {
+      operations.emplace_back(WorkloadOperation::kWrite, arguments[1],
+                              static_cast<uint32_t>(arguments[0]));
+    } else if (name == "Read" && arguments.size() == 2) {
+      operations.emplace_back(WorkloadOperation::kRead, arguments[1],
+                              static_cast<uint32_t>(arguments[0]));
+    } else if (name == "Truncate" && arguments.size() == 1) {
+      operations.emplace_back(WorkloadOperation::kTruncate, arguments[0], 0);
+    } else if (name == "Flush") {
+      operations.emplace_back(WorkloadOperation::kFlush, 0, 0);
+    } else if (name == "Close") {
+      operations.emplace_back(WorkloadOperation::kClose, 0, 0);
+    }
+  }
+  return operations;
+}
+
+double Microseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0;
+}
+
+void PrintLatencies(WorkloadLatencies& latencies) {
+  std::cout << std::left << std::setw(10) << "Operation" << std::right << std::setw(10)
+            << "Count" << std::setw(12) << "p50 (us)" << std::setw(12) << "p90 (us)"
+            << std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)" << std::setw(14)
+            << "total (ms)" << '\n'
+            << std::fixed << std::setprecision(1);
+  for (int type(0); type != WorkloadOperation::kTypeCount; ++type) {
+    auto& samples(latencies[type]);
+    if (samples.empty())
+      continue;
+    std::sort(std::begin(samples), std::end(samples));
+    auto percentile([&samples](double fraction) {
+      return Microseconds(samples[static_cast<size_t>(fraction * (samples.size() - 1))]);
+    });
+    std::chrono::steady_clock::duration total(std::chrono::steady_clock::duration::zero());
+    for (const auto& sample : samples)
+      total += sample;
+    std::cout << std::left << std::setw(10) << kOperationNames[type] << std::right
+              << std::setw(10) << samples.size() << std::setw(12) << percentile(0.5)
+              << std::setw(12) << percentile(0.9) << std::setw(12) << percentile(0.99)
+              << std::setw(12) << percentile(1.0) << std::setw(14) << Microseconds(total) / 1000
+              << '\n';
+  }
+}
+
+int Replay(const std::string& trace_file) {
+  std::ifstream source(trace_file, std::ios::binary);
+  std::vector<WorkloadOperation> operations(ReadWorkloadTrace(source));
+  fs::path store_path(fs::temp_directory_path() / fs::unique_path("replay_%%%%-%%%%-%%%%"));
+  WorkloadLatencies latencies;
+  {
+    DataBuffer<std::string> store(
+        MemoryUsage(512 * 1024 * 1024), DiskUsage(std::numeric_limits<uint64_t>::max()),
+        [](const std::string&, const NonEmptyString&) {
+          BOOST_THROW_EXCEPTION(MakeError(CommonErrors::cannot_exceed_limit));
+        },
+        store_path);
+    DataMap data_map;
+    SelfEncryptor self_encryptor(data_map, store,
+                                 [&store](const std::string& name) { return store.Get(name); });
+    auto start(std::chrono::steady_clock::now());
+    latencies = ReplayWorkload(operations, self_encryptor);
+    self_encryptor.Close();
+    std::cout << trace_file << ": " << operations.size() << " operations in "
+              << Microseconds(std::chrono::steady_clock::now() - start) / 1000
+              << " ms (including the final Close)\n";
+  }
+  boost::system::error_code error_code;
+  fs::remove_all(store_path, error_code);
+  PrintLatencies(latencies);
+  return 0;
+}
+
+}  // unnamed namespace
+
+int Run(int argc, char* argv[]) {
+  try {
+    if (argc == 4 && std::string(argv[1]) == "--import") {
+      std::ifstream source(argv[2]);
+      std::vector<WorkloadOperation> operations(ImportTranscribedTest(source));
+      std::ofstream sink(argv[3], std::ios::binary);
+      WriteWorkloadTrace(operations, sink);
+      std::cout << "Imported " << operations.size() << " operations\n";
+      return 0;
+    }
+    if (argc < 2 || std::string(argv[1]).compare(0, 2, "--") == 0) {
+      std::cout << "Usage: replay_workload_encrypt <trace file>...\n"
+                << "       replay_workload_encrypt --import <test source> <trace file>\n";
+      return 1;
+    }
+    for (int i(1); i != argc; ++i)
+      Replay(argv[i]);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Replay failed: " << boost::diagnostic_information(e) << '\n';
+    return 2;
+  }
+  return 0;
+}
+
+}  // namespace benchmark
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+int main(int argc, char* argv[]) { return maidsafe::encrypt::benchmark::Run(argc, argv); }
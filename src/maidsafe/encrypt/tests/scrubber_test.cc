@@ -0,0 +1,147 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/scrubber.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/sha.h"
+#ifdef WIN32
+#pragma warning(pop)
+#endif
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+class ScrubberTest : public testing::Test {
+ protected:
+  ScrubberTest() : store_(), fetch_count_(0), get_from_store_() {
+    get_from_store_ = [this](const std::string& name) -> NonEmptyString {
+      ++fetch_count_;
+      auto itr(store_.find(name));
+      if (itr == std::end(store_))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      return NonEmptyString(itr->second);
+    };
+  }
+
+  // Stores a random chunk under its SHA512 and returns its details.
+  ChunkDetails StoreChunk() {
+    std::string content(RandomString(1024 + RandomUint32() % 1024));
+    std::string name(crypto::SHA512::DIGESTSIZE, 0);
+    CryptoPP::SHA512().CalculateDigest(reinterpret_cast<byte*>(&name[0]),
+                                       reinterpret_cast<const byte*>(content.data()),
+                                       content.size());
+    store_[name] = content;
+    ChunkDetails chunk;
+    chunk.hash.assign(std::begin(name), std::end(name));
+    chunk.size = static_cast<uint32_t>(content.size());
+    chunk.storage_state = ChunkDetails::kStored;
+    return chunk;
+  }
+
+  DataMap CreateDataMap(uint32_t num_chunks) {
+    DataMap data_map;
+    for (uint32_t i(0); i != num_chunks; ++i)
+      data_map.chunks.push_back(StoreChunk());
+    return data_map;
+  }
+
+  std::string Name(const ChunkDetails& chunk) {
+    return std::string(std::begin(chunk.hash), std::end(chunk.hash));
+  }
+
+  std::map<std::string, std::string> store_;
+  std::atomic<int> fetch_count_;
+  std::function<NonEmptyString(const std::string&)> get_from_store_;
+};
+
+TEST_F(ScrubberTest, BEH_AllChunksValid) {
+  std::vector<DataMap> data_maps;
+  for (int i(0); i != 10; ++i)
+    data_maps.push_back(CreateDataMap(20));
+  // Chunks shared between data maps should only be fetched once.
+  data_maps.push_back(data_maps[0]);
+  store_.erase(Name(data_maps[1].chunks[5]));
+  data_maps[1].chunks[5] = data_maps[2].chunks[7];
+  uint64_t total_size(0);
+  for (const auto& chunk : store_)
+    total_size += chunk.second.size();
+
+  ScrubReport report(ScrubDataMaps(data_maps, get_from_store_));
+  EXPECT_EQ(199U, report.chunks_checked);
+  EXPECT_EQ(199, fetch_count_);
+  EXPECT_EQ(total_size, report.bytes_checked);
+  EXPECT_TRUE(report.missing_chunks.empty());
+  EXPECT_TRUE(report.corrupt_chunks.empty());
+
+  EXPECT_EQ(0U, ScrubDataMaps(std::vector<DataMap>(), get_from_store_).chunks_checked);
+}
+
+TEST_F(ScrubberTest, BEH_MissingAndCorruptChunks) {
+  std::vector<DataMap> data_maps;
+  for (int i(0); i != 5; ++i)
+    data_maps.push_back(CreateDataMap(50));
+  std::vector<ByteVector> missing, corrupt;
+  for (int i(0); i != 5; ++i) {
+    missing.push_back(data_maps[i].chunks[i * 3].hash);
+    store_.erase(Name(data_maps[i].chunks[i * 3]));
+    corrupt.push_back(data_maps[i].chunks[i * 3 + 1].hash);
+    store_[Name(data_maps[i].chunks[i * 3 + 1])][10] ^= 1;
+  }
+  std::sort(std::begin(missing), std::end(missing));
+  std::sort(std::begin(corrupt), std::end(corrupt));
+
+  for (int concurrency : {1, 3, 64}) {
+    ScrubReport report(ScrubDataMaps(data_maps, get_from_store_, concurrency));
+    EXPECT_EQ(250U, report.chunks_checked);
+    EXPECT_EQ(missing, report.missing_chunks);
+    EXPECT_EQ(corrupt, report.corrupt_chunks);
+  }
+}
+
+TEST_F(ScrubberTest, BEH_InvalidParameters) {
+  std::vector<DataMap> data_maps(1, CreateDataMap(3));
+  EXPECT_THROW(ScrubDataMaps(data_maps, nullptr), common_error);
+  EXPECT_THROW(ScrubDataMaps(data_maps, get_from_store_, 0), common_error);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
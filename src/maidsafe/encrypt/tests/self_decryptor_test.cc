@@ -0,0 +1,129 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/self_decryptor.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+class SelfDecryptorTest : public EncryptTestBase, public testing::Test {
+ protected:
+  // Self-encrypts |content| as a new file, leaving data_map_ describing it.
+  void WriteFile(const std::string& content) {
+    self_encryptor_->Close();
+    data_map_ = DataMap();
+    self_encryptor_ =
+        maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+    ASSERT_TRUE(
+        self_encryptor_->Write(content.data(), static_cast<uint32_t>(content.size()), 0));
+    self_encryptor_->Close();
+  }
+};
+
+TEST_F(SelfDecryptorTest, BEH_ReadsWhatWasWritten) {
+  // Held in the data map, three chunks, and many chunks.
+  for (uint32_t size : {100U, 3 * kMinChunkSize + 5, 10 * kMaxChunkSize + 123}) {
+    const std::string kContent(RandomString(size));
+    WriteFile(kContent);
+    SelfDecryptor decryptor(data_map_, get_from_store_);
+    EXPECT_EQ(size, decryptor.size());
+    std::string read(size, 0);
+    ASSERT_TRUE(decryptor.Read(&read[0], size, 0));
+    EXPECT_EQ(kContent, read);
+
+    // Across a chunk boundary, and past the end.
+    const uint32_t kPosition(size / 3 - 10);
+    std::string piece(20, 0);
+    ASSERT_TRUE(decryptor.Read(&piece[0], 20, kPosition));
+    EXPECT_EQ(kContent.substr(kPosition, 20), piece);
+    EXPECT_TRUE(decryptor.Read(&piece[0], 0, size));
+    EXPECT_FALSE(decryptor.Read(&piece[0], 20, size - 19));
+  }
+}
+
+TEST_F(SelfDecryptorTest, BEH_ConcurrentReadsShareCache) {
+  const uint32_t kNumChunks(20);
+  const std::string kContent(RandomString(kNumChunks * kMaxChunkSize));
+  WriteFile(kContent);
+  // Big enough that even if every chunk lands in the same shard, none is evicted.
+  auto cache(std::make_shared<ChunkCache>(16ULL * kNumChunks * kMaxChunkSize));
+  SelfDecryptor decryptor(data_map_, get_from_store_, cache);
+
+  // Every thread reads the whole file a chunk at a time, each starting from a different chunk.
+  auto read_on_threads([&](const SelfDecryptor& reader) {
+    std::vector<std::future<bool>> readers;
+    for (uint32_t i(0); i != 8; ++i) {
+      readers.emplace_back(std::async(std::launch::async, [&, i]() -> bool {
+        std::string read(kMaxChunkSize, 0);
+        for (uint32_t j(0); j != kNumChunks; ++j) {
+          uint64_t position(static_cast<uint64_t>((i + j) % kNumChunks) * kMaxChunkSize);
+          if (!reader.Read(&read[0], kMaxChunkSize, position) ||
+              read != kContent.substr(static_cast<size_t>(position), kMaxChunkSize)) {
+            return false;
+          }
+        }
+        return true;
+      }));
+    }
+    for (auto& reader_result : readers)
+      EXPECT_TRUE(reader_result.get());
+  });
+  read_on_threads(decryptor);
+  // Concurrent Reads missing the same chunk wait for one fetch of it.
+  EXPECT_EQ(kNumChunks, decryptor.stats().chunks_fetched);
+  EXPECT_EQ(8U * kNumChunks - kNumChunks, decryptor.stats().cache_hits);
+  EXPECT_EQ(kNumChunks * kMaxChunkSize, cache->size());
+
+  // Another decryptor of the same file finds every chunk already in the shared cache.
+  SelfDecryptor other_decryptor(data_map_, get_from_store_, cache);
+  read_on_threads(other_decryptor);
+  EXPECT_EQ(0U, other_decryptor.stats().chunks_fetched);
+  EXPECT_EQ(8U * kNumChunks, other_decryptor.stats().cache_hits);
+  EXPECT_EQ(8U * kNumChunks * kMaxChunkSize, other_decryptor.stats().bytes_read);
+}
+
+TEST_F(SelfDecryptorTest, BEH_InvalidArguments) {
+  EXPECT_THROW(SelfDecryptor decryptor(DataMap(), nullptr), common_error);
+  EXPECT_THROW(SelfDecryptor decryptor(CreateSyntheticDataMap(2), get_from_store_), common_error);
+  DataMap no_pre_hash(CreateSyntheticDataMap(3));
+  no_pre_hash.chunks[1].pre_hash.clear();
+  EXPECT_THROW(SelfDecryptor decryptor(no_pre_hash, get_from_store_), common_error);
+  self_encryptor_->Close();
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
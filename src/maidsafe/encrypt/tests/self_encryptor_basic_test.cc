@@ -100,8 +100,11 @@ TEST_F(EncryptBasicTest, BEH_LargeFileWithLargeGap) {
   EXPECT_EQ(result, temp);
   EXPECT_TRUE(self_encryptor_->Write(&temp.data()[0], size, 0));
   // write a large gap in the file
-  // EXPECT_TRUE(self_encryptor_->Write(&temp.data()[0], size, size * 2));
+  EXPECT_TRUE(self_encryptor_->Write(&temp.data()[0], size, size * 2));
+  EXPECT_TRUE(self_encryptor_->Read(res, size, size));
+  EXPECT_EQ(std::string(size, 0), std::string(res, res + size));
   self_encryptor_->Close();
+  EXPECT_EQ(3U * size, data_map_.size());
 }
 
 }  // namespace test
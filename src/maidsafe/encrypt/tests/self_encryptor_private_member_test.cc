@@ -29,6 +29,7 @@
 #include "maidsafe/common/data_buffer.h"
 
 #include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/chunk_status_table.h"
 #include "maidsafe/encrypt/data_map.h"
 #include "maidsafe/encrypt/config.h"
 #include "maidsafe/encrypt/tests/encrypt_test_base.h"
@@ -62,7 +63,7 @@ class PrivateSelfEncryptorTest : public testing::Test {
  protected:
   virtual void TearDown() { self_encryptor_->closed_ = true; }
   uint64_t size() { return self_encryptor_->file_size_; }
-  size_t ChunksSize() { return self_encryptor_->chunks_.size(); }
+  size_t ChunksSize() { return self_encryptor_->chunks_->size(); }
   uint32_t GetChunkSize(uint32_t chunk_num) { return self_encryptor_->GetChunkSize(chunk_num); }
   uint32_t GetNumChunks() { return self_encryptor_->GetNumChunks(); }
   std::pair<uint64_t, uint64_t> GetStartEndPositions(uint32_t chunk_number) {
@@ -77,6 +78,7 @@ class PrivateSelfEncryptorTest : public testing::Test {
 
   uint32_t GetChunkNumber(uint64_t position) { return self_encryptor_->GetChunkNumber(position); }
   void SetEncryptorSize(uint64_t size) { self_encryptor_->file_size_ = size; }
+  size_t JournalledChunks() { return self_encryptor_->journal_.chunks.size(); }
   maidsafe::test::TestPath test_dir_;
   int num_procs_;
   DataBuffer<std::string> local_store_;
@@ -231,6 +233,32 @@ TEST_F(PrivateSelfEncryptorTest, BEH_HelpersEqual5MaxChunks) {
   EXPECT_EQ(GetStartEndPositions(4).first, 4 * kMaxChunkSize);
   EXPECT_EQ(GetStartEndPositions(4).second, 5 * kMaxChunkSize);
 }
+TEST_F(PrivateSelfEncryptorTest, BEH_JournalHoldsOnlyChangedChunks) {
+  const std::string kContent(RandomString(10 * kMaxChunkSize));
+  EXPECT_TRUE(self_encryptor_->Write(kContent.data(), static_cast<uint32_t>(kContent.size()), 0));
+  self_encryptor_->Close();
+  const DataMap kOriginal(data_map_);
+
+  self_encryptor_.reset(new SelfEncryptor(data_map_, local_store_, get_from_store_));
+  EXPECT_EQ(0U, JournalledChunks());
+  // Chunk 5 and the two after it, whose keys depend on its pre-hash, are re-encrypted.
+  EXPECT_TRUE(self_encryptor_->Write("x", 1, 5 * kMaxChunkSize + 100));
+  self_encryptor_->Close();
+  EXPECT_EQ(3U, JournalledChunks());
+  EXPECT_TRUE(kOriginal != data_map_);
+  EXPECT_TRUE(kOriginal == self_encryptor_->original_data_map());
+  EXPECT_TRUE(kOriginal != self_encryptor_->data_map());
+
+  // Chunks dropped by truncating are journalled too.
+  const DataMap kBeforeTruncate(data_map_);
+  self_encryptor_.reset(new SelfEncryptor(data_map_, local_store_, get_from_store_));
+  EXPECT_TRUE(self_encryptor_->Truncate(6 * kMaxChunkSize));
+  self_encryptor_->Close();
+  EXPECT_EQ(6U, data_map_.chunks.size());
+  EXPECT_LE(4U, JournalledChunks());
+  EXPECT_TRUE(kBeforeTruncate == self_encryptor_->original_data_map());
+}
+
 }  // namespace test
 
 }  // namespace encrypt
@@ -0,0 +1,235 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/self_encryptor_stats.h"
+
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+class SelfEncryptorStatsTest : public EncryptTestBase, public testing::Test {
+ protected:
+  SelfEncryptorStatsTest() : EncryptTestBase(), kDataSize_(10 * kMaxChunkSize) {}
+  const uint32_t kDataSize_;
+};
+
+TEST_F(SelfEncryptorStatsTest, BEH_WriteThenRead) {
+  ResetProcessSelfEncryptorStats();
+  std::string content(RandomString(kDataSize_));
+  ASSERT_TRUE(self_encryptor_->Write(content.data(), kDataSize_, 0));
+  self_encryptor_->Close();
+
+  SelfEncryptorStats written(self_encryptor_->stats());
+  EXPECT_EQ(kDataSize_, written.bytes_written);
+  EXPECT_EQ(0U, written.bytes_read);
+  EXPECT_EQ(0U, written.chunks_fetched);
+  EXPECT_EQ(0U, written.chunks_decrypted);
+  EXPECT_EQ(data_map_.chunks.size(), written.chunks_encrypted);
+  EXPECT_EQ(data_map_.chunks.size(), written.chunks_stored);
+  EXPECT_GT(written.encrypt_time.count(), 0);
+  EXPECT_GT(written.hash_time.count(), 0);
+  EXPECT_GE(written.peak_sequencer_bytes, kDataSize_);
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::unique_ptr<char[]> read(new char[kDataSize_]);
+  ASSERT_TRUE(self_encryptor_->Read(read.get(), kDataSize_, 0));
+  EXPECT_EQ(content, std::string(read.get(), kDataSize_));
+  SelfEncryptorStats read_stats(self_encryptor_->stats());
+  EXPECT_EQ(0U, read_stats.bytes_written);
+  EXPECT_EQ(kDataSize_, read_stats.bytes_read);
+  EXPECT_EQ(data_map_.chunks.size(), read_stats.chunks_fetched);
+  EXPECT_EQ(data_map_.chunks.size(), read_stats.chunks_decrypted);
+  // The first three chunks are decrypted when the encryptor is opened.
+  EXPECT_GE(read_stats.cache_hits, 3U);
+  EXPECT_GT(read_stats.fetch_time.count(), 0);
+  EXPECT_GT(read_stats.decrypt_time.count(), 0);
+  self_encryptor_->Close();
+
+  SelfEncryptorStats process(ProcessSelfEncryptorStats());
+  EXPECT_EQ(written.bytes_written, process.bytes_written);
+  EXPECT_EQ(read_stats.bytes_read, process.bytes_read);
+  EXPECT_EQ(read_stats.chunks_fetched, process.chunks_fetched);
+  EXPECT_GE(process.chunks_stored, written.chunks_stored);
+  EXPECT_GE(process.peak_sequencer_bytes, kDataSize_);
+
+  ResetProcessSelfEncryptorStats();
+  EXPECT_EQ(0U, ProcessSelfEncryptorStats().bytes_written);
+  EXPECT_EQ(kDataSize_, self_encryptor_->stats().bytes_read);
+}
+
+TEST_F(SelfEncryptorStatsTest, BEH_OverwriteSkipsFetch) {
+  std::string content(RandomString(kDataSize_));
+  ASSERT_TRUE(self_encryptor_->Write(content.data(), kDataSize_, 0));
+  self_encryptor_->Close();
+
+  // Chunks 3 to 6 are replaced outright; 7 and 8 are re-encrypted as their keys depend on 6.
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string replacement(RandomString(4 * kMaxChunkSize));
+  ASSERT_TRUE(self_encryptor_->Write(replacement.data(), 4 * kMaxChunkSize, 3 * kMaxChunkSize));
+  SelfEncryptorStats stats(self_encryptor_->stats());
+  EXPECT_EQ(4U, stats.fetches_skipped);
+  EXPECT_EQ(5U, stats.chunks_fetched);
+  self_encryptor_->Close();
+  content.replace(3 * kMaxChunkSize, replacement.size(), replacement);
+
+  // One byte short at the start, so chunk 3 must be fetched.
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  ASSERT_TRUE(self_encryptor_->Write(replacement.data(), 4 * kMaxChunkSize - 1,
+                                     3 * kMaxChunkSize + 1));
+  EXPECT_EQ(3U, self_encryptor_->stats().fetches_skipped);
+  self_encryptor_->Close();
+  content.replace(3 * kMaxChunkSize + 1, 4 * kMaxChunkSize - 1, replacement, 0,
+                  4 * kMaxChunkSize - 1);
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(kDataSize_, 0);
+  ASSERT_TRUE(self_encryptor_->Read(&read[0], kDataSize_, 0));
+  EXPECT_EQ(content, read);
+  EXPECT_EQ(0U, self_encryptor_->stats().fetches_skipped);
+  self_encryptor_->Close();
+}
+
+TEST_F(SelfEncryptorStatsTest, BEH_MemoryAccounting) {
+  ResetProcessSelfEncryptorStats();
+  const uint64_t kBaseline(ProcessSelfEncryptorStats().memory_bytes);
+  std::string content(RandomString(kDataSize_));
+  {
+    DataMap data_map;
+    SelfEncryptor self_encryptor(data_map, local_store_, get_from_store_);
+    // Nothing is held for an empty file.
+    EXPECT_EQ(0U, self_encryptor.stats().memory_bytes);
+    ASSERT_TRUE(self_encryptor.Write(content.data(), kDataSize_, 0));
+    self_encryptor.Close();
+
+    SelfEncryptorStats stats(self_encryptor.stats());
+    // The file buffer is still held; the chunk temporaries used by Close have been released.
+    EXPECT_GE(stats.memory_bytes, kDataSize_);
+    EXPECT_LT(stats.memory_bytes, 2U * kDataSize_);
+    EXPECT_GT(stats.peak_memory_bytes, stats.memory_bytes);
+    EXPECT_LE(stats.peak_memory_bytes, 5U * kDataSize_);
+    SelfEncryptorStats process(ProcessSelfEncryptorStats());
+    EXPECT_EQ(kBaseline + stats.memory_bytes, process.memory_bytes);
+    EXPECT_GE(process.peak_memory_bytes, kBaseline + stats.peak_memory_bytes);
+  }
+  EXPECT_EQ(kBaseline, ProcessSelfEncryptorStats().memory_bytes);
+
+  ResetProcessSelfEncryptorStats();
+  EXPECT_EQ(kBaseline, ProcessSelfEncryptorStats().memory_bytes);
+  EXPECT_EQ(kBaseline, ProcessSelfEncryptorStats().peak_memory_bytes);
+  self_encryptor_->Close();
+}
+
+TEST_F(SelfEncryptorStatsTest, BEH_ConcurrentWritesChargeWholeAllocation) {
+  const uint32_t kWriters(16);
+  const std::string kContent(RandomString(3 * (kWriters + 2) * kMaxChunkSize));
+  ASSERT_TRUE(
+      self_encryptor_->Write(kContent.data(), static_cast<uint32_t>(kContent.size()), 0));
+  self_encryptor_->Close();
+
+  // Each Write fetches the three chunks of its own window, which no other Write's overlaps.
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  const std::string kPatch(RandomString(100));
+  std::vector<std::future<bool>> writers;
+  for (uint32_t i(0); i != kWriters; ++i) {
+    writers.emplace_back(std::async(std::launch::async, [&, i] {
+      return self_encryptor_->Write(kPatch.data(), 100, (3 * i + 3) * kMaxChunkSize);
+    }));
+  }
+  for (auto& writer : writers)
+    EXPECT_TRUE(writer.get());
+
+  // Once the Writes are done, the charge matches the sequencer's allocation exactly.
+  SelfEncryptorStats stats(self_encryptor_->stats());
+  EXPECT_EQ(stats.peak_sequencer_bytes, stats.memory_bytes);
+  EXPECT_LE(static_cast<uint64_t>(3 * (kWriters + 1)) * kMaxChunkSize, stats.memory_bytes);
+  self_encryptor_->Close();
+}
+
+TEST_F(SelfEncryptorStatsTest, BEH_SparseFileReusesZeroChunks) {
+  // A header followed by a 100-chunk hole.  The hole costs no memory, and of its chunks only the
+  // first two (whose keys depend on the header) and one other need encrypting.
+  const uint64_t kFileSize(100 * kMaxChunkSize);
+  const std::string kHeader(RandomString(4096));
+  ASSERT_TRUE(self_encryptor_->Truncate(kFileSize));
+  EXPECT_EQ(0U, self_encryptor_->stats().memory_bytes);
+  ASSERT_TRUE(self_encryptor_->Write(kHeader.data(), static_cast<uint32_t>(kHeader.size()), 0));
+  self_encryptor_->Close();
+
+  SelfEncryptorStats stats(self_encryptor_->stats());
+  EXPECT_EQ(4U, stats.chunks_encrypted);
+  EXPECT_EQ(96U, stats.zero_chunks_reused);
+  EXPECT_LT(stats.peak_memory_bytes, kFileSize / 4);
+  ASSERT_EQ(100U, data_map_.chunks.size());
+  for (size_t i(4); i != data_map_.chunks.size(); ++i) {
+    EXPECT_EQ(data_map_.chunks[3].hash, data_map_.chunks[i].hash) << i;
+    EXPECT_EQ(kMaxChunkSize, data_map_.chunks[i].size) << i;
+  }
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  EXPECT_EQ(kFileSize, self_encryptor_->size());
+  std::string read(kHeader.size(), 1);
+  ASSERT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), 0));
+  EXPECT_EQ(kHeader, read);
+  ASSERT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), kFileSize / 2));
+  EXPECT_EQ(std::string(kHeader.size(), 0), read);
+  ASSERT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()),
+                                    kFileSize - read.size()));
+  EXPECT_EQ(std::string(kHeader.size(), 0), read);
+  self_encryptor_->Close();
+}
+
+TEST(SelfEncryptorStatsNamesTest, BEH_ToNamedValues) {
+  SelfEncryptorStats stats;
+  stats.bytes_written = 1;
+  stats.store_time = std::chrono::microseconds(2);
+  auto values(ToNamedValues(stats));
+  std::set<std::string> names;
+  for (const auto& value : values) {
+    EXPECT_TRUE(names.insert(value.first).second) << value.first;
+    if (value.first == "bytes_written")
+      EXPECT_EQ(1U, value.second);
+    else if (value.first == "store_time_ns")
+      EXPECT_EQ(2000U, value.second);
+    else
+      EXPECT_EQ(0U, value.second) << value.first;
+  }
+  EXPECT_EQ(17U, names.size());
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
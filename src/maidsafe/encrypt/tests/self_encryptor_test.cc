@@ -19,9 +19,11 @@
 #include <algorithm>
 #include <array>
 #include <cstdlib>
+#include <future>
 #include <random>
 #include <string>
 #include <thread>
+#include <vector>
 
 #ifdef WIN32
 #pragma warning(push, 1)
@@ -48,6 +50,7 @@
 
 #include "maidsafe/encrypt/self_encryptor.h"
 #include "maidsafe/encrypt/data_map_encryptor.h"
+#include "maidsafe/encrypt/merkle_tree.h"
 #include "maidsafe/encrypt/config.h"
 #include "maidsafe/encrypt/tests/encrypt_test_base.h"
 
@@ -1277,6 +1280,93 @@ TEST_F(BasicTest, BEH_TruncateIncreaseDecrease) {
   }
 }
 
+TEST_F(BasicTest, BEH_WriteEndingMidChunkReencryptsTwoChunksOn) {
+  // Chunk n is encrypted using the pre-hashes of chunks n - 1 and n - 2, so a Write ending part way
+  // into chunk 3 must see chunk 5 re-encrypted, though it's still remote on reopening.
+  std::string content(RandomString(8 * kMaxChunkSize));
+  EXPECT_TRUE(self_encryptor_->Write(content.data(), static_cast<uint32_t>(content.size()), 0));
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  const std::string kPatch(RandomString(100));
+  EXPECT_TRUE(self_encryptor_->Write(kPatch.data(), 100, 3 * kMaxChunkSize - 50));
+  content.replace(3 * kMaxChunkSize - 50, 100, kPatch);
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(kMaxChunkSize, 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], kMaxChunkSize, 5 * kMaxChunkSize));
+  EXPECT_EQ(content.substr(5 * kMaxChunkSize, kMaxChunkSize), read);
+  read.assign(content.size(), 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(content.size()), 0));
+  EXPECT_EQ(content, read);
+  self_encryptor_->Close();
+}
+
+TEST_F(BasicTest, BEH_CloseUpdatesMerkleRoot) {
+  const std::string kContent(RandomString(8 * kMaxChunkSize));
+  EXPECT_TRUE(self_encryptor_->Write(kContent.data(), static_cast<uint32_t>(kContent.size()), 0));
+  self_encryptor_->Close();
+  data_map_.merkle_root = MerkleTree(data_map_).root();
+  const ByteVector kOriginalRoot(data_map_.merkle_root);
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  const std::string kPatch(RandomString(4096));
+  EXPECT_TRUE(self_encryptor_->Write(kPatch.data(), 4096, 3 * kMaxChunkSize + 100));
+  self_encryptor_->Close();
+  EXPECT_NE(kOriginalRoot, data_map_.merkle_root);
+  EXPECT_EQ(MerkleTree(data_map_).root(), data_map_.merkle_root);
+
+  // Once small enough to be held as content, the data map has no chunks and so no root.
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  EXPECT_TRUE(self_encryptor_->Truncate(100));
+  self_encryptor_->Close();
+  EXPECT_TRUE(data_map_.chunks.empty());
+  EXPECT_TRUE(data_map_.merkle_root.empty());
+  EXPECT_EQ(100U, data_map_.size());
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(100, 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], 100, 0));
+  EXPECT_EQ(kContent.substr(0, 100), read);
+
+  // Growing it back into chunks drops the content.
+  EXPECT_TRUE(self_encryptor_->Write(kContent.data() + 100, 4 * kMaxChunkSize, 100));
+  self_encryptor_->Close();
+  EXPECT_TRUE(data_map_.content.empty());
+  EXPECT_EQ(4 * kMaxChunkSize + 100, data_map_.size());
+}
+
+TEST_F(BasicTest, BEH_ResizeAfterReopening) {
+  // Resizing reshapes the chunks at the end of the file, which are still remote after reopening.
+  std::string expected(RandomString(10 * kMaxChunkSize + 300));
+  EXPECT_TRUE(self_encryptor_->Write(expected.data(), static_cast<uint32_t>(expected.size()), 0));
+  self_encryptor_->Close();
+  auto check_contents([&] {
+    self_encryptor_->Close();
+    self_encryptor_ =
+        maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+    std::string read(expected.size(), 1);
+    EXPECT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), 0));
+    EXPECT_TRUE(read == expected);
+  });
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  EXPECT_TRUE(self_encryptor_->Truncate(5 * kMaxChunkSize + 7));
+  expected.resize(5 * kMaxChunkSize + 7);
+  check_contents();
+
+  const std::string kAppended(RandomString(kMaxChunkSize / 2));
+  EXPECT_TRUE(self_encryptor_->Write(kAppended.data(), static_cast<uint32_t>(kAppended.size()),
+                                     expected.size()));
+  expected += kAppended;
+  check_contents();
+
+  EXPECT_TRUE(self_encryptor_->Truncate(expected.size() + 3 * kMaxChunkSize));
+  expected.resize(expected.size() + 3 * kMaxChunkSize, 0);
+  check_contents();
+  self_encryptor_->Close();
+}
+
 TEST_F(BasicTest, FUNC_RandomAccess) {
   uint32_t chunk_size(1024);
   std::vector<uint32_t> num_of_tries;
@@ -1430,6 +1520,170 @@ TEST_F(BasicTest, FUNC_ReadAfterClose) {
   }
 }
 
+TEST_F(BasicTest, BEH_OwnershipTransferringWrite) {
+  const std::string kContent(RandomString(5 * kMaxChunkSize + 7));
+  ByteVector whole_file(std::begin(kContent), std::end(kContent));
+  EXPECT_TRUE(self_encryptor_->Write(std::move(whole_file), 0));
+  EXPECT_TRUE(whole_file.empty());
+  EXPECT_EQ(kContent.size(), self_encryptor_->size());
+
+  // Not the whole file, so copied.
+  const std::string kPatch(RandomString(kMaxChunkSize));
+  const uint64_t kPatchPosition(2 * kMaxChunkSize - 5);
+  ByteVector patch(std::begin(kPatch), std::end(kPatch));
+  EXPECT_TRUE(self_encryptor_->Write(std::move(patch), kPatchPosition));
+  EXPECT_TRUE(patch.empty());
+  std::string expected(kContent);
+  expected.replace(kPatchPosition, kPatch.size(), kPatch);
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(expected.size(), 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), 0));
+  EXPECT_EQ(expected, read);
+
+  // One whole chunk on a chunk boundary is adopted, here extending the file.
+  const std::string kChunk(RandomString(kMaxChunkSize));
+  EXPECT_TRUE(self_encryptor_->Write(ByteVector(std::begin(kChunk), std::end(kChunk)),
+                                     5 * kMaxChunkSize));
+  expected.resize(5 * kMaxChunkSize);
+  expected += kChunk;
+  self_encryptor_->Close();
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  read.assign(expected.size(), 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), 0));
+  EXPECT_EQ(expected, read);
+  self_encryptor_->Close();
+}
+
+TEST_F(BasicTest, BEH_SparseWritesPastFourGigabytes) {
+  // Chunk offsets past 4 GiB don't fit in 32 bits.  Everything else in the file is a hole.
+  const uint64_t kGigabyte(1024ULL * 1024 * 1024);
+  const uint64_t kFileSize(5 * kGigabyte);
+  const std::vector<uint64_t> kPositions{3 * kGigabyte, 4 * kGigabyte + 12345};
+  const std::string kContent(RandomString(4096));
+  EXPECT_TRUE(self_encryptor_->Truncate(kFileSize));
+  for (uint64_t position : kPositions)
+    EXPECT_TRUE(self_encryptor_->Write(kContent.data(), 4096, position));
+  self_encryptor_->Close();
+  EXPECT_EQ(kFileSize, data_map_.size());
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(4096, 0);
+  for (uint64_t position : kPositions) {
+    EXPECT_TRUE(self_encryptor_->Read(&read[0], 4096, position));
+    EXPECT_TRUE(read == kContent) << position;
+  }
+  // The zeros either side of the data are still there.
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], 4096, kPositions.back() - 4096));
+  EXPECT_EQ(std::string(4096, 0), read);
+  self_encryptor_->Close();
+}
+
+TEST_F(BasicTest, BEH_ConcurrentReads) {
+  const uint32_t kNumChunks(20);
+  const std::string kContent(RandomString(kNumChunks * kMaxChunkSize));
+  EXPECT_TRUE(self_encryptor_->Write(kContent.data(), static_cast<uint32_t>(kContent.size()), 0));
+  self_encryptor_->Close();
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+
+  // Every thread reads the whole file a chunk at a time, each starting from a different chunk, so
+  // most chunks are missed by several threads at once.
+  const uint32_t kNumThreads(8);
+  std::vector<std::future<bool>> readers;
+  for (uint32_t i(0); i != kNumThreads; ++i) {
+    readers.emplace_back(std::async(std::launch::async, [&, i]() -> bool {
+      std::string read(kMaxChunkSize, 0);
+      for (uint32_t j(0); j != kNumChunks; ++j) {
+        uint64_t position(static_cast<uint64_t>((i + j) % kNumChunks) * kMaxChunkSize);
+        if (!self_encryptor_->Read(&read[0], kMaxChunkSize, position) ||
+            read != kContent.substr(static_cast<size_t>(position), kMaxChunkSize)) {
+          return false;
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto& reader : readers)
+    EXPECT_TRUE(reader.get());
+  // However many readers missed a chunk, it was only fetched once.
+  EXPECT_EQ(kNumChunks, self_encryptor_->stats().chunks_fetched);
+  self_encryptor_->Close();
+}
+
+TEST_F(BasicTest, BEH_ConcurrentWritesToDisjointRanges) {
+  const uint32_t kNumThreads(8), kChunksPerThread(5), kPieceSize(4096);
+  const uint64_t kRegionSize(static_cast<uint64_t>(kChunksPerThread) * kMaxChunkSize);
+  // Two spare chunks at the end keep every writer clear of the file's last two chunks.
+  EXPECT_TRUE(self_encryptor_->Truncate((kNumThreads + 2) * kRegionSize));
+  const std::string kContent(RandomString(static_cast<size_t>(kNumThreads * kRegionSize)));
+
+  std::vector<std::future<bool>> writers;
+  for (uint32_t i(0); i != kNumThreads; ++i) {
+    writers.emplace_back(std::async(std::launch::async, [&, i]() -> bool {
+      for (uint64_t offset(0); offset < kRegionSize; offset += kPieceSize) {
+        uint64_t position(i * kRegionSize + offset);
+        if (!self_encryptor_->Write(kContent.data() + position, kPieceSize, position))
+          return false;
+      }
+      return true;
+    }));
+  }
+  for (auto& writer : writers)
+    EXPECT_TRUE(writer.get());
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::string read(kContent.size(), 0);
+  EXPECT_TRUE(self_encryptor_->Read(&read[0], static_cast<uint32_t>(read.size()), 0));
+  EXPECT_TRUE(read == kContent);
+  self_encryptor_->Close();
+}
+
+#ifndef WIN32
+TEST_F(BasicTest, BEH_ScatterGatherWriteAndRead) {
+  // Page-sized and odd-sized buffers, spanning chunk boundaries.
+  const std::vector<uint32_t> kBufferSizes{4096, 4096, 1, 0, kMaxChunkSize + 17, 4096, 333};
+  uint32_t total(0);
+  for (uint32_t size : kBufferSizes)
+    total += size;
+  const uint64_t kPosition(kMaxChunkSize - 100);
+  const std::string kContent(RandomString(total));
+  std::vector<std::string> pieces;
+  for (uint32_t offset(0), i(0); i != kBufferSizes.size(); offset += kBufferSizes[i++])
+    pieces.push_back(kContent.substr(offset, kBufferSizes[i]));
+  std::vector<iovec> write_buffers;
+  for (auto& piece : pieces)
+    write_buffers.push_back(iovec{piece.empty() ? nullptr : &piece[0], piece.size()});
+  EXPECT_TRUE(self_encryptor_->Write(write_buffers.data(), static_cast<int>(write_buffers.size()),
+                                     kPosition));
+  EXPECT_EQ(kPosition + kContent.size(), self_encryptor_->size());
+
+  std::string single(kContent.size(), 0);
+  EXPECT_TRUE(self_encryptor_->Read(&single[0], static_cast<uint32_t>(single.size()), kPosition));
+  EXPECT_EQ(kContent, single);
+  self_encryptor_->Close();
+
+  self_encryptor_ = maidsafe::make_unique<SelfEncryptor>(data_map_, local_store_, get_from_store_);
+  std::vector<std::string> read_pieces;
+  for (uint32_t size : kBufferSizes)
+    read_pieces.push_back(std::string(size, 0));
+  std::vector<iovec> read_buffers;
+  for (auto& piece : read_pieces)
+    read_buffers.push_back(iovec{piece.empty() ? nullptr : &piece[0], piece.size()});
+  EXPECT_TRUE(self_encryptor_->Read(read_buffers.data(), static_cast<int>(read_buffers.size()),
+                                    kPosition));
+  std::string gathered;
+  for (const auto& piece : read_pieces)
+    gathered += piece;
+  EXPECT_EQ(kContent, gathered);
+  EXPECT_FALSE(self_encryptor_->Read(read_buffers.data(), static_cast<int>(read_buffers.size()),
+                                     kPosition + 1));
+  EXPECT_THROW(self_encryptor_->Read(read_buffers.data(), -1, 0), common_error);
+  self_encryptor_->Close();
+}
+#endif
+
 
 }  // namespace test
 
@@ -0,0 +1,152 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/sequencer.h"
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+const uint64_t kSegment(Sequencer::kSegmentSize);
+
+ByteVector ReadBack(const Sequencer& sequencer, uint64_t length, uint64_t position) {
+  ByteVector data(length, 1);
+  sequencer.Read(data.data(), length, position);
+  return data;
+}
+
+ByteVector RandomBytes(uint64_t length) {
+  std::string random(RandomString(static_cast<size_t>(length)));
+  return ByteVector(std::begin(random), std::end(random));
+}
+
+}  // unnamed namespace
+
+TEST(SequencerTest, BEH_HolesCostNothing) {
+  Sequencer sequencer;
+  const uint64_t kHundredGigabytes(100ULL * 1024 * 1024 * 1024);
+  sequencer.Resize(kHundredGigabytes);
+  EXPECT_EQ(kHundredGigabytes, sequencer.size());
+  EXPECT_EQ(0U, sequencer.allocated_bytes());
+  EXPECT_TRUE(sequencer.IsHole(0, kHundredGigabytes));
+  EXPECT_TRUE(sequencer.IsZero(kHundredGigabytes - 3 * kSegment, 3 * kSegment));
+  EXPECT_EQ(ByteVector(100, 0), ReadBack(sequencer, 100, kHundredGigabytes - 100));
+
+  // Writing zeros over a hole leaves it a hole.
+  ByteVector zeros(2 * kSegment, 0);
+  sequencer.Write(zeros.data(), zeros.size(), kSegment / 2);
+  EXPECT_EQ(0U, sequencer.allocated_bytes());
+
+  const ByteVector kData(RandomBytes(10));
+  sequencer.Write(kData.data(), kData.size(), kHundredGigabytes - 5);
+  EXPECT_EQ(kHundredGigabytes + 5, sequencer.size());
+  EXPECT_EQ(2 * kSegment, sequencer.allocated_bytes());
+  EXPECT_EQ(kData, ReadBack(sequencer, kData.size(), kHundredGigabytes - 5));
+  EXPECT_FALSE(sequencer.IsHole(kHundredGigabytes - 5, 1));
+  EXPECT_TRUE(sequencer.IsHole(0, kHundredGigabytes - kSegment));
+  EXPECT_FALSE(sequencer.IsZero(kHundredGigabytes - kSegment, kSegment));
+  EXPECT_TRUE(sequencer.IsZero(kHundredGigabytes - kSegment, kSegment - 5));
+}
+
+TEST(SequencerTest, BEH_WriteAndReadAcrossSegments) {
+  Sequencer sequencer;
+  const ByteVector kData(RandomBytes(3 * kSegment + 7));
+  sequencer.Write(kData.data(), kData.size(), 11);
+  EXPECT_EQ(kData.size() + 11, sequencer.size());
+  EXPECT_EQ(ByteVector(11, 0), ReadBack(sequencer, 11, 0));
+  EXPECT_EQ(kData, ReadBack(sequencer, kData.size(), 11));
+
+  // Within one segment the view is in place; across two it's gathered.
+  ByteVector scratch;
+  const byte* view(sequencer.View(kSegment + 1, 100, scratch));
+  EXPECT_TRUE(scratch.empty());
+  EXPECT_EQ(ByteVector(kData.begin() + kSegment - 10, kData.begin() + kSegment + 90),
+            ByteVector(view, view + 100));
+  view = sequencer.View(kSegment - 50, 100, scratch);
+  EXPECT_EQ(100U, scratch.size());
+  EXPECT_EQ(ByteVector(kData.begin() + kSegment - 61, kData.begin() + kSegment + 39),
+            ByteVector(view, view + 100));
+}
+
+TEST(SequencerTest, BEH_ShrinkThenGrowReadsZeros) {
+  Sequencer sequencer;
+  const ByteVector kData(RandomBytes(2 * kSegment));
+  sequencer.Write(kData.data(), kData.size(), 0);
+  EXPECT_EQ(2 * kSegment, sequencer.allocated_bytes());
+  sequencer.Resize(kSegment / 2);
+  EXPECT_EQ(kSegment, sequencer.allocated_bytes());
+  sequencer.Resize(2 * kSegment);
+  EXPECT_EQ(ByteVector(kData.begin(), kData.begin() + kSegment / 2),
+            ReadBack(sequencer, kSegment / 2, 0));
+  EXPECT_TRUE(sequencer.IsZero(kSegment / 2, kSegment + kSegment / 2));
+  EXPECT_TRUE(sequencer.IsHole(kSegment, kSegment));
+}
+
+TEST(SequencerTest, BEH_Adopt) {
+  Sequencer sequencer;
+  ByteVector partial(RandomBytes(kSegment - 1));
+  EXPECT_FALSE(sequencer.Adopt(partial, 0));
+  EXPECT_EQ(kSegment - 1, partial.size());
+  ByteVector whole(RandomBytes(kSegment));
+  EXPECT_FALSE(sequencer.Adopt(whole, 1));
+  const ByteVector kWhole(whole);
+  const byte* const kStorage(whole.data());
+  EXPECT_TRUE(sequencer.Adopt(whole, kSegment));
+  EXPECT_TRUE(whole.empty());
+  EXPECT_EQ(2 * kSegment, sequencer.size());
+  EXPECT_EQ(kSegment, sequencer.allocated_bytes());
+  ByteVector scratch;
+  EXPECT_EQ(kStorage, sequencer.View(kSegment, kSegment, scratch));
+  EXPECT_EQ(kWhole, ReadBack(sequencer, kSegment, kSegment));
+  EXPECT_TRUE(sequencer.IsHole(0, kSegment));
+}
+
+TEST(SequencerTest, BEH_ReserveThenAppend) {
+  Sequencer sequencer;
+  sequencer.Reserve(100 * kSegment);
+  EXPECT_EQ(0U, sequencer.size());
+  EXPECT_EQ(0U, sequencer.allocated_bytes());
+
+  // Appending in small pieces leaves earlier segments where they were.
+  const ByteVector kData(RandomBytes(3 * kSegment));
+  const uint64_t kPiece(4096);
+  sequencer.Write(kData.data(), kPiece, 0);
+  ByteVector scratch;
+  const byte* const kFirst(sequencer.View(0, kPiece, scratch));
+  for (uint64_t position(kPiece); position < kData.size(); position += kPiece)
+    sequencer.Write(kData.data() + position, kPiece, position);
+  EXPECT_EQ(kData.size(), sequencer.size());
+  EXPECT_EQ(3 * kSegment, sequencer.allocated_bytes());
+  EXPECT_EQ(kFirst, sequencer.View(0, kPiece, scratch));
+  EXPECT_EQ(kData, ReadBack(sequencer, kData.size(), 0));
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
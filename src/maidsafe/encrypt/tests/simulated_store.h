@@ -0,0 +1,202 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_TESTS_SIMULATED_STORE_H_
+#define MAIDSAFE_ENCRYPT_TESTS_SIMULATED_STORE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "boost/exception/all.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+// How a simulated remote store behaves.  The default is a zero-latency, unlimited store.
+struct SimulatedStoreProfile {
+  SimulatedStoreProfile()
+      : median_latency(0), latency_spread(0.0), bandwidth(0), max_concurrent_gets(0),
+        failure_rate(0.0) {}
+  SimulatedStoreProfile(std::chrono::microseconds median_latency_in, double latency_spread_in,
+                        uint64_t bandwidth_in, int max_concurrent_gets_in, double failure_rate_in)
+      : median_latency(median_latency_in), latency_spread(latency_spread_in),
+        bandwidth(bandwidth_in), max_concurrent_gets(max_concurrent_gets_in),
+        failure_rate(failure_rate_in) {}
+
+  // Per-request latency is lognormal with this median.  |latency_spread| is the sigma of the
+  // underlying normal distribution; 0 gives a constant latency, 0.5 puts p99 at about 3x median.
+  std::chrono::microseconds median_latency;
+  double latency_spread;
+  uint64_t bandwidth;  // Bytes per second shared by all requests, or 0 for unlimited
+  int max_concurrent_gets;  // Further Gets block until a slot is free, or 0 for unlimited
+  double failure_rate;  // Probability that a Get throws after its latency has elapsed
+};
+
+// Wraps a zero-latency getter such as DataBuffer::Get so that it behaves like a remote store, to
+// allow benchmarking fetch-bound paths on a single machine.  Thread-safe.
+class SimulatedStore {
+ public:
+  struct Statistics {
+    Statistics() : gets(0), failures(0), bytes(0), queued(0), busy(0) {}
+    uint64_t gets, failures, bytes;
+    std::chrono::microseconds queued;  // Total time spent waiting for a concurrency slot
+    std::chrono::microseconds busy;    // Total time spent in latency and transfer
+  };
+
+  SimulatedStore(std::function<NonEmptyString(const std::string&)> backing_get,
+                 const SimulatedStoreProfile& profile, uint32_t seed = RandomUint32())
+      : backing_get_(std::move(backing_get)),
+        kProfile_(profile),
+        mutex_(),
+        slot_freed_(),
+        in_flight_(0),
+        link_free_at_(std::chrono::steady_clock::now()),
+        random_engine_(seed),
+        statistics_() {
+    if (!backing_get_ || profile.latency_spread < 0.0 || profile.max_concurrent_gets < 0 ||
+        profile.failure_rate < 0.0 || profile.failure_rate > 1.0) {
+      LOG(kError) << "Invalid simulated store parameters.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+  SimulatedStore(const SimulatedStore&) = delete;
+  SimulatedStore& operator=(const SimulatedStore&) = delete;
+
+  NonEmptyString Get(const std::string& name) {
+    auto queued_at(std::chrono::steady_clock::now());
+    std::chrono::steady_clock::duration latency;
+    bool fail(false);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_freed_.wait(lock, [this] {
+        return kProfile_.max_concurrent_gets == 0 || in_flight_ < kProfile_.max_concurrent_gets;
+      });
+      ++in_flight_;
+      ++statistics_.gets;
+      statistics_.queued += std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - queued_at);
+      latency = DrawLatency();
+      fail = std::bernoulli_distribution(kProfile_.failure_rate)(random_engine_);
+      if (fail)
+        ++statistics_.failures;
+    }
+    auto started_at(std::chrono::steady_clock::now());
+    Releaser releaser(*this, started_at);
+    std::this_thread::sleep_for(latency);
+    if (fail) {
+      LOG(kVerbose) << "Simulating failure to get " << HexSubstr(name);
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::unable_to_handle_request));
+    }
+
+    NonEmptyString content(backing_get_(name));
+    if (kProfile_.bandwidth != 0) {
+      // Transfers share the link one after another, so concurrent Gets see the combined cost.
+      std::chrono::steady_clock::time_point done_at;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto transfer(std::chrono::microseconds(content.string().size() * 1000000 /
+                                                kProfile_.bandwidth));
+        link_free_at_ = std::max(link_free_at_, std::chrono::steady_clock::now()) + transfer;
+        done_at = link_free_at_;
+        statistics_.bytes += content.string().size();
+      }
+      std::this_thread::sleep_until(done_at);
+    } else {
+      std::lock_guard<std::mutex> lock(mutex_);
+      statistics_.bytes += content.string().size();
+    }
+    return content;
+  }
+
+  // A functor suitable for passing to a SelfEncryptor.  Must not outlive this store.
+  std::function<NonEmptyString(const std::string&)> Getter() {
+    return [this](const std::string& name) { return Get(name); };
+  }
+
+  Statistics statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+ private:
+  // Frees the concurrency slot and records busy time however Get exits.
+  class Releaser {
+   public:
+    Releaser(SimulatedStore& store, std::chrono::steady_clock::time_point started_at)
+        : store_(store), started_at_(started_at) {}
+    Releaser(const Releaser&) = delete;
+    Releaser& operator=(const Releaser&) = delete;
+    ~Releaser() {
+      {
+        std::lock_guard<std::mutex> lock(store_.mutex_);
+        --store_.in_flight_;
+        store_.statistics_.busy += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started_at_);
+      }
+      store_.slot_freed_.notify_one();
+    }
+
+   private:
+    SimulatedStore& store_;
+    std::chrono::steady_clock::time_point started_at_;
+  };
+
+  // Requires |mutex_| to be held.
+  std::chrono::steady_clock::duration DrawLatency() {
+    if (kProfile_.median_latency.count() == 0)
+      return std::chrono::steady_clock::duration::zero();
+    if (kProfile_.latency_spread == 0.0)
+      return kProfile_.median_latency;
+    std::lognormal_distribution<double> distribution(
+        std::log(static_cast<double>(kProfile_.median_latency.count())), kProfile_.latency_spread);
+    return std::chrono::microseconds(static_cast<int64_t>(distribution(random_engine_)));
+  }
+
+  std::function<NonEmptyString(const std::string&)> backing_get_;
+  const SimulatedStoreProfile kProfile_;
+  mutable std::mutex mutex_;
+  std::condition_variable slot_freed_;
+  int in_flight_;
+  std::chrono::steady_clock::time_point link_free_at_;
+  std::mt19937 random_engine_;
+  Statistics statistics_;
+};
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_TESTS_SIMULATED_STORE_H_
@@ -0,0 +1,131 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/tests/simulated_store.h"
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+class SimulatedStoreTest : public testing::Test {
+ protected:
+  SimulatedStoreTest() : contents_() {
+    for (int i(0); i != 10; ++i)
+      contents_[std::to_string(i)] = NonEmptyString(RandomString(10 * 1024));
+  }
+
+  std::function<NonEmptyString(const std::string&)> BackingGet() {
+    return [this](const std::string& name) -> NonEmptyString {
+      auto itr(contents_.find(name));
+      if (itr == std::end(contents_))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+      return itr->second;
+    };
+  }
+
+  // Runs one Get per stored item concurrently, returning the elapsed time.
+  std::chrono::milliseconds GetAllConcurrently(SimulatedStore& store) {
+    auto start(std::chrono::steady_clock::now());
+    std::vector<std::future<NonEmptyString>> gets;
+    for (const auto& content : contents_) {
+      gets.emplace_back(std::async(std::launch::async, [&store, &content] {
+        return store.Get(content.first);
+      }));
+    }
+    for (auto& get : gets)
+      get.get();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                 start);
+  }
+
+  std::map<std::string, NonEmptyString> contents_;
+};
+
+TEST_F(SimulatedStoreTest, BEH_PassThrough) {
+  SimulatedStore store(BackingGet(), SimulatedStoreProfile());
+  auto getter(store.Getter());
+  for (const auto& content : contents_)
+    EXPECT_EQ(content.second.string(), getter(content.first).string());
+  EXPECT_THROW(getter("missing"), common_error);
+  SimulatedStore::Statistics statistics(store.statistics());
+  EXPECT_EQ(contents_.size() + 1, statistics.gets);
+  EXPECT_EQ(0U, statistics.failures);
+  EXPECT_EQ(contents_.size() * 10 * 1024, statistics.bytes);
+}
+
+TEST_F(SimulatedStoreTest, BEH_ConcurrencyLimit) {
+  // Ten 20 ms requests, two at a time, take at least five rounds.
+  SimulatedStore store(BackingGet(), SimulatedStoreProfile(std::chrono::milliseconds(20), 0.0, 0,
+                                                           2, 0.0));
+  EXPECT_LE(100, GetAllConcurrently(store).count());
+  EXPECT_LT(0, store.statistics().queued.count());
+}
+
+TEST_F(SimulatedStoreTest, BEH_BandwidthIsShared) {
+  // 100 KB at 1 MB/s takes at least 100 ms however many requests run at once.
+  SimulatedStore store(BackingGet(), SimulatedStoreProfile(std::chrono::microseconds(0), 0.0,
+                                                           1000 * 1000, 0, 0.0));
+  EXPECT_LE(100, GetAllConcurrently(store).count());
+  EXPECT_EQ(0, store.statistics().queued.count());
+}
+
+TEST_F(SimulatedStoreTest, BEH_InjectedFailures) {
+  SimulatedStore always_fails(BackingGet(), SimulatedStoreProfile(std::chrono::microseconds(0),
+                                                                  0.0, 0, 0, 1.0));
+  EXPECT_THROW(always_fails.Get("0"), common_error);
+  EXPECT_EQ(1U, always_fails.statistics().failures);
+  EXPECT_EQ(0U, always_fails.statistics().bytes);
+
+  SimulatedStore sometimes_fails(BackingGet(), SimulatedStoreProfile(
+                                                   std::chrono::microseconds(0), 0.0, 0, 0, 0.5));
+  int failures(0);
+  for (int i(0); i != 1000; ++i) {
+    try {
+      sometimes_fails.Get("0");
+    }
+    catch (const common_error&) {
+      ++failures;
+    }
+  }
+  EXPECT_EQ(static_cast<uint64_t>(failures), sometimes_fails.statistics().failures);
+  EXPECT_LT(350, failures);
+  EXPECT_GT(650, failures);
+
+  EXPECT_THROW(SimulatedStore(BackingGet(), SimulatedStoreProfile(std::chrono::microseconds(0),
+                                                                  0.0, 0, 0, 1.5)),
+               common_error);
+  EXPECT_THROW(SimulatedStore(nullptr, SimulatedStoreProfile()), common_error);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,126 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ENCRYPT_TESTS_SYNTHETIC_DATA_H_
+#define MAIDSAFE_ENCRYPT_TESTS_SYNTHETIC_DATA_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <random>
+#include <string>
+
+#include "boost/exception/all.hpp"
+
+#include "maidsafe/common/config.h"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+// Shape of the data produced by GenerateSyntheticData.  The defaults give incompressible, unique,
+// dense data.
+struct SyntheticDataProfile {
+  SyntheticDataProfile()
+      : compression_ratio(1.0), duplicate_chunk_ratio(0.0), island_fraction(1.0),
+        island_size(64 * 1024) {}
+  SyntheticDataProfile(double compression_ratio_in, double duplicate_chunk_ratio_in,
+                       double island_fraction_in, uint32_t island_size_in = 64 * 1024)
+      : compression_ratio(compression_ratio_in),
+        duplicate_chunk_ratio(duplicate_chunk_ratio_in),
+        island_fraction(island_fraction_in),
+        island_size(island_size_in) {}
+
+  // Approximate original / compressed size of the non-zero data under Gzip.  Each 4 KiB block
+  // starts with 1 / compression_ratio random bytes and is zero-filled after that.
+  double compression_ratio;
+  // Fraction of kMaxChunkSize-aligned chunks (after the first) which copy an earlier chunk.
+  double duplicate_chunk_ratio;
+  // Fraction of |island_size| regions which hold data; the rest are zeros, as in a sparse file.
+  double island_fraction;
+  uint32_t island_size;
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const SyntheticDataProfile& profile) {
+  return stream << "ratio " << profile.compression_ratio << ", duplicates "
+                << profile.duplicate_chunk_ratio << ", islands " << profile.island_fraction;
+}
+
+// Fills |data| deterministically from |seed|, so that runs with the same seed are comparable.
+inline void GenerateSyntheticData(const SyntheticDataProfile& profile, uint64_t seed, char* data,
+                                  uint64_t size) {
+  if (profile.compression_ratio < 1.0 || profile.duplicate_chunk_ratio < 0.0 ||
+      profile.duplicate_chunk_ratio > 1.0 || profile.island_fraction < 0.0 ||
+      profile.island_fraction > 1.0 || profile.island_size == 0) {
+    LOG(kError) << "Invalid synthetic data profile: " << profile;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  const uint64_t kBlockSize(4096);
+  const uint64_t kRandomPerBlock(
+      std::max<uint64_t>(1, static_cast<uint64_t>(kBlockSize / profile.compression_ratio)));
+  std::mt19937_64 engine(seed);
+  std::bernoulli_distribution is_island(profile.island_fraction);
+  std::bernoulli_distribution is_duplicate(profile.duplicate_chunk_ratio);
+
+  std::memset(data, 0, static_cast<size_t>(size));
+  // Dense data first, in sparse islands.
+  for (uint64_t island(0); island < size; island += profile.island_size) {
+    uint64_t island_end(std::min(size, island + profile.island_size));
+    if (!is_island(engine))
+      continue;
+    for (uint64_t block(island); block < island_end; block += kBlockSize) {
+      uint64_t random_end(std::min(island_end, block + kRandomPerBlock));
+      uint64_t i(block);
+      for (; i + sizeof(uint64_t) <= random_end; i += sizeof(uint64_t)) {
+        uint64_t value(engine());
+        std::memcpy(data + i, &value, sizeof(value));
+      }
+      for (uint64_t value(engine()); i < random_end; ++i, value >>= 8)
+        data[i] = static_cast<char>(value);
+    }
+  }
+  // Then overwrite some whole chunks with copies of earlier ones.
+  const uint64_t kNumChunks(size / kMaxChunkSize);
+  for (uint64_t chunk(1); chunk < kNumChunks; ++chunk) {
+    if (is_duplicate(engine)) {
+      uint64_t source(std::uniform_int_distribution<uint64_t>(0, chunk - 1)(engine));
+      std::memcpy(data + chunk * kMaxChunkSize, data + source * kMaxChunkSize, kMaxChunkSize);
+    }
+  }
+}
+
+inline std::string GenerateSyntheticData(const SyntheticDataProfile& profile, uint64_t seed,
+                                         uint64_t size) {
+  std::string data(static_cast<size_t>(size), 0);
+  if (size != 0)
+    GenerateSyntheticData(profile, seed, &data[0], size);
+  return data;
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ENCRYPT_TESTS_SYNTHETIC_DATA_H_
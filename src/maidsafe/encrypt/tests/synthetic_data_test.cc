@@ -0,0 +1,109 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/tests/synthetic_data.h"
+
+#include <set>
+#include <string>
+
+#ifdef WIN32
+#pragma warning(push, 1)
+#endif
+#include "cryptopp/filters.h"
+#include "cryptopp/gzip.h"
+#ifdef WIN32
+#pragma warning(pop)
+#endif
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/encrypt/config.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+// Compressed with the settings SelfEncryptor uses.
+double CompressionRatio(const std::string& data) {
+  std::string compressed;
+  CryptoPP::Gzip gzip(new CryptoPP::StringSink(compressed), 1);
+  gzip.Put2(reinterpret_cast<const byte*>(data.data()), data.size(), -1, true);
+  return static_cast<double>(data.size()) / compressed.size();
+}
+
+}  // unnamed namespace
+
+TEST(SyntheticDataTest, BEH_Deterministic) {
+  SyntheticDataProfile profile(3.0, 0.5, 0.5);
+  const uint64_t kSize(4 * kMaxChunkSize + 123);
+  EXPECT_EQ(GenerateSyntheticData(profile, 1, kSize), GenerateSyntheticData(profile, 1, kSize));
+  EXPECT_NE(GenerateSyntheticData(profile, 1, kSize), GenerateSyntheticData(profile, 2, kSize));
+  EXPECT_TRUE(GenerateSyntheticData(profile, 1, 0).empty());
+  EXPECT_THROW(GenerateSyntheticData(SyntheticDataProfile(0.5, 0.0, 1.0), 1, kSize),
+               common_error);
+  EXPECT_THROW(GenerateSyntheticData(SyntheticDataProfile(1.0, 1.5, 1.0), 1, kSize),
+               common_error);
+}
+
+TEST(SyntheticDataTest, BEH_CompressionRatio) {
+  const uint64_t kSize(kMaxChunkSize);
+  EXPECT_GT(1.1, CompressionRatio(GenerateSyntheticData(SyntheticDataProfile(), 1, kSize)));
+  for (double ratio : {2.0, 4.0, 10.0}) {
+    double achieved(CompressionRatio(
+        GenerateSyntheticData(SyntheticDataProfile(ratio, 0.0, 1.0), 1, kSize)));
+    EXPECT_LT(ratio * 0.7, achieved) << ratio;
+    EXPECT_GT(ratio * 1.5, achieved) << ratio;
+  }
+}
+
+TEST(SyntheticDataTest, BEH_DuplicateChunks) {
+  const uint64_t kNumChunks(100);
+  std::string data(GenerateSyntheticData(SyntheticDataProfile(1.0, 0.3, 1.0), 1,
+                                         kNumChunks * kMaxChunkSize));
+  std::set<std::string> unique_chunks;
+  for (uint64_t i(0); i != kNumChunks; ++i)
+    unique_chunks.insert(data.substr(i * kMaxChunkSize, kMaxChunkSize));
+  uint64_t duplicates(kNumChunks - unique_chunks.size());
+  EXPECT_LT(15U, duplicates);
+  EXPECT_GT(45U, duplicates);
+}
+
+TEST(SyntheticDataTest, BEH_SparseIslands) {
+  const uint32_t kIslandSize(64 * 1024);
+  const uint64_t kNumIslands(1000);
+  std::string data(GenerateSyntheticData(SyntheticDataProfile(1.0, 0.0, 0.1, kIslandSize), 1,
+                                         kNumIslands * kIslandSize));
+  const std::string kZeros(kIslandSize, 0);
+  uint64_t islands(0);
+  for (uint64_t i(0); i != kNumIslands; ++i) {
+    if (data.compare(i * kIslandSize, kIslandSize, kZeros) != 0)
+      ++islands;
+  }
+  EXPECT_LT(60U, islands);
+  EXPECT_GT(140U, islands);
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,137 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/tracer.h"
+
+#include <future>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+namespace {
+
+size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+  size_t count(0);
+  for (size_t pos(text.find(pattern)); pos != std::string::npos;
+       pos = text.find(pattern, pos + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+}  // unnamed namespace
+
+TEST(TracerTest, BEH_RecordFromManyThreads) {
+  const int kThreads(8), kSpansPerThread(1000);
+  Tracer tracer(kThreads * kSpansPerThread);
+  std::vector<std::future<void>> futures;
+  for (int i(0); i != kThreads; ++i) {
+    futures.emplace_back(std::async(std::launch::async, [&tracer, i] {
+      for (int j(0); j != kSpansPerThread; ++j)
+        TraceSpan span(&tracer, (i % 2) ? "Odd" : "Even", j);
+    }));
+  }
+  for (auto& future : futures)
+    future.get();
+  EXPECT_EQ(static_cast<size_t>(kThreads * kSpansPerThread), tracer.size());
+  EXPECT_EQ(0U, tracer.dropped());
+
+  std::ostringstream trace;
+  tracer.WriteChromeTrace(trace);
+  const std::string kTrace(trace.str());
+  EXPECT_EQ(0U, kTrace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  EXPECT_EQ(kTrace.size() - 4, kTrace.rfind("\n]}\n"));
+  EXPECT_EQ(static_cast<size_t>(kThreads * kSpansPerThread),
+            CountOccurrences(kTrace, "\"ph\":\"X\""));
+  EXPECT_EQ(static_cast<size_t>(kThreads * kSpansPerThread / 2),
+            CountOccurrences(kTrace, "\"name\":\"Odd\""));
+  EXPECT_EQ(static_cast<size_t>(kThreads), CountOccurrences(kTrace, "\"args\":{\"chunk\":999}"));
+}
+
+TEST(TracerTest, BEH_DropsWhenFull) {
+  Tracer tracer(10);
+  for (int i(0); i != 15; ++i)
+    TraceSpan span(&tracer, "Span");
+  EXPECT_EQ(10U, tracer.size());
+  EXPECT_EQ(5U, tracer.dropped());
+  std::ostringstream trace;
+  tracer.WriteChromeTrace(trace);
+  EXPECT_EQ(10U, CountOccurrences(trace.str(), "\"name\":\"Span\""));
+  EXPECT_EQ(0U, CountOccurrences(trace.str(), "\"args\""));
+  EXPECT_THROW(Tracer(0), common_error);
+}
+
+class SelfEncryptorTracingTest : public EncryptTestBase, public testing::Test {};
+
+TEST_F(SelfEncryptorTracingTest, BEH_TracesChunkPipeline) {
+  Tracer tracer;
+  self_encryptor_->set_tracer(&tracer);
+  const uint32_t kDataSize(5 * kMaxChunkSize);
+  std::string content(RandomString(kDataSize));
+  ASSERT_TRUE(self_encryptor_->Write(content.data(), kDataSize, 0));
+  self_encryptor_->Close();
+  self_encryptor_->set_tracer(nullptr);
+
+  std::ostringstream trace;
+  tracer.WriteChromeTrace(trace);
+  const std::string kTrace(trace.str());
+  EXPECT_EQ(1U, CountOccurrences(kTrace, "\"name\":\"Close\""));
+  EXPECT_LE(1U, CountOccurrences(kTrace, "\"name\":\"PrepareWindow\""));
+  EXPECT_EQ(data_map_.chunks.size(), CountOccurrences(kTrace, "\"name\":\"EncryptChunk\""));
+  EXPECT_EQ(data_map_.chunks.size(), CountOccurrences(kTrace, "\"name\":\"Store\""));
+  for (size_t i(0); i != data_map_.chunks.size(); ++i) {
+    EXPECT_LE(2U, CountOccurrences(kTrace, "\"args\":{\"chunk\":" + std::to_string(i) + "}"))
+        << i;
+  }
+
+  Tracer read_tracer;
+  SelfEncryptor reader(data_map_, local_store_, get_from_store_);
+  reader.set_tracer(&read_tracer);
+  std::string read(kDataSize, 0);
+  ASSERT_TRUE(reader.Read(&read[0], kDataSize, 0));
+  reader.set_tracer(nullptr);
+  reader.Close();
+  EXPECT_EQ(content, read);
+  std::ostringstream read_trace;
+  read_tracer.WriteChromeTrace(read_trace);
+  // The first three chunks are decrypted before the tracer is set.
+  EXPECT_EQ(data_map_.chunks.size() - 3,
+            CountOccurrences(read_trace.str(), "\"name\":\"DecryptChunk\""));
+  EXPECT_EQ(data_map_.chunks.size() - 3, CountOccurrences(read_trace.str(), "\"name\":\"Fetch\""));
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
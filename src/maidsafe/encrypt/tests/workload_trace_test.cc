@@ -0,0 +1,136 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/workload_trace.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/config.h"
+#include "maidsafe/encrypt/self_encryptor.h"
+#include "maidsafe/encrypt/tests/encrypt_test_base.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace test {
+
+TEST(WorkloadTraceTest, BEH_RoundTrip) {
+  std::vector<WorkloadOperation> operations;
+  operations.emplace_back(WorkloadOperation::kWrite, 0, 4096);
+  operations.emplace_back(WorkloadOperation::kWrite, 1ULL << 40, kMaxChunkSize);
+  operations.emplace_back(WorkloadOperation::kRead, 100, 0);
+  operations.emplace_back(WorkloadOperation::kTruncate, 12345, 0);
+  operations.emplace_back(WorkloadOperation::kFlush, 0, 0);
+  operations.emplace_back(WorkloadOperation::kRead, 0, 0xFFFFFFFF);
+  operations.emplace_back(WorkloadOperation::kClose, 0, 0);
+  for (int i(0); i != 100; ++i) {
+    operations.emplace_back(static_cast<WorkloadOperation::Type>(RandomUint32() % 2),
+                            RandomUint32(), RandomUint32() % (2 * kMaxChunkSize));
+  }
+
+  std::stringstream trace;
+  WriteWorkloadTrace(operations, trace);
+  EXPECT_EQ(operations, ReadWorkloadTrace(trace));
+
+  std::stringstream empty_trace;
+  WriteWorkloadTrace(std::vector<WorkloadOperation>(), empty_trace);
+  EXPECT_TRUE(ReadWorkloadTrace(empty_trace).empty());
+}
+
+TEST(WorkloadTraceTest, BEH_SequentialIsCompact) {
+  std::vector<WorkloadOperation> operations;
+  for (uint64_t i(0); i != 1000; ++i)
+    operations.emplace_back(WorkloadOperation::kWrite, i * 4096, 4096);
+  std::ostringstream trace;
+  WriteWorkloadTrace(operations, trace);
+  EXPECT_GE(5U + 4 * operations.size(), trace.str().size());
+}
+
+TEST(WorkloadTraceTest, BEH_RejectsInvalidTraces) {
+  std::vector<WorkloadOperation> operations(1, WorkloadOperation(WorkloadOperation::kWrite, 0,
+                                                                 kMaxChunkSize));
+  std::ostringstream trace;
+  WriteWorkloadTrace(operations, trace);
+  const std::string kTrace(trace.str());
+
+  for (size_t size(0); size != kTrace.size(); ++size) {
+    if (size == 5)  // A complete, empty trace
+      continue;
+    std::istringstream truncated(kTrace.substr(0, size));
+    EXPECT_THROW(ReadWorkloadTrace(truncated), common_error) << size;
+  }
+  std::string bad_magic(kTrace);
+  bad_magic[0] = 'X';
+  std::istringstream bad_magic_stream(bad_magic);
+  EXPECT_THROW(ReadWorkloadTrace(bad_magic_stream), common_error);
+  std::string bad_type(kTrace);
+  bad_type[5] = static_cast<char>(WorkloadOperation::kTypeCount);
+  std::istringstream bad_type_stream(bad_type);
+  EXPECT_THROW(ReadWorkloadTrace(bad_type_stream), common_error);
+}
+
+class WorkloadRecorderTest : public EncryptTestBase, public testing::Test {};
+
+TEST_F(WorkloadRecorderTest, BEH_RecordAndReplay) {
+  const uint32_t kDataSize(4 * kMaxChunkSize);
+  std::string content(RandomString(kDataSize)), read(kDataSize, 0);
+  WorkloadRecorder recorder(*self_encryptor_);
+  ASSERT_TRUE(recorder.Write(content.data(), kDataSize / 2, 0));
+  ASSERT_TRUE(recorder.Write(content.data() + kDataSize / 2, kDataSize / 2, kDataSize / 2));
+  ASSERT_TRUE(recorder.Read(&read[0], kDataSize, 0));
+  EXPECT_EQ(content, read);
+  EXPECT_FALSE(recorder.Read(&read[0], 1, kDataSize + 1));
+  ASSERT_TRUE(recorder.Truncate(kDataSize - 1));
+  ASSERT_TRUE(recorder.Flush());
+  recorder.Close();
+
+  std::vector<WorkloadOperation> expected;
+  expected.emplace_back(WorkloadOperation::kWrite, 0, kDataSize / 2);
+  expected.emplace_back(WorkloadOperation::kWrite, kDataSize / 2, kDataSize / 2);
+  expected.emplace_back(WorkloadOperation::kRead, 0, kDataSize);
+  expected.emplace_back(WorkloadOperation::kRead, kDataSize + 1, 1);
+  expected.emplace_back(WorkloadOperation::kTruncate, kDataSize - 1, 0);
+  expected.emplace_back(WorkloadOperation::kFlush, 0, 0);
+  expected.emplace_back(WorkloadOperation::kClose, 0, 0);
+  EXPECT_EQ(expected, recorder.operations());
+  EXPECT_EQ(kDataSize - 1, data_map_.size());
+
+  DataMap replay_data_map;
+  SelfEncryptor replayer(replay_data_map, local_store_, get_from_store_);
+  WorkloadLatencies latencies(ReplayWorkload(recorder.operations(), replayer));
+  EXPECT_EQ(2U, latencies[WorkloadOperation::kWrite].size());
+  EXPECT_EQ(2U, latencies[WorkloadOperation::kRead].size());
+  EXPECT_EQ(1U, latencies[WorkloadOperation::kTruncate].size());
+  EXPECT_EQ(1U, latencies[WorkloadOperation::kFlush].size());
+  EXPECT_EQ(1U, latencies[WorkloadOperation::kClose].size());
+  EXPECT_EQ(data_map_.size(), replay_data_map.size());
+  EXPECT_EQ(data_map_.chunks.size(), replay_data_map.chunks.size());
+}
+
+}  // namespace test
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
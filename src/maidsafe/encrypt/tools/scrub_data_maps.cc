@@ -0,0 +1,134 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Checks that every chunk referenced by a set of serialised data maps is present in a local
+// directory-backed store (one file per chunk, named by the hex-encoded chunk name) and hashes to
+// its name.
+//
+// Usage: scrub_data_maps [--concurrency <n>] <store directory> <data map file>...
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/exception/all.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/encrypt/data_map.h"
+#include "maidsafe/encrypt/scrubber.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace tools {
+
+enum ReturnCodes {
+  kSuccess = 0,
+  kInvalidArgumentsError,
+  kReadDataMapError,
+  kScrubFailed
+};
+
+void PrintUsage() {
+  std::cout << "Usage: scrub_data_maps [--concurrency <n>] <store directory> <data map file>...\n";
+}
+
+int Scrub(int argc, char* argv[]) {
+  int concurrency(Concurrency());
+  int arg(1);
+  if (argc > 2 && std::string(argv[1]) == "--concurrency") {
+    try {
+      concurrency = std::stoi(argv[2]);
+    }
+    catch (const std::exception&) {
+      concurrency = 0;
+    }
+    if (concurrency < 1) {
+      PrintUsage();
+      return kInvalidArgumentsError;
+    }
+    arg = 3;
+  }
+  if (argc - arg < 2) {
+    PrintUsage();
+    return kInvalidArgumentsError;
+  }
+
+  const fs::path kStoreDir(argv[arg++]);
+  std::vector<DataMap> data_maps;
+  for (; arg != argc; ++arg) {
+    std::string serialised_data_map;
+    data_maps.emplace_back();
+    try {
+      if (!ReadFile(argv[arg], &serialised_data_map))
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+      ParseDataMap(serialised_data_map, data_maps.back());
+    }
+    catch (const std::exception& e) {
+      std::cout << "Failed to read data map " << argv[arg] << ": "
+                << boost::diagnostic_information(e) << '\n';
+      return kReadDataMapError;
+    }
+  }
+
+  auto get_from_store([&](const std::string& name) -> NonEmptyString {
+    std::string content;
+    if (!ReadFile(kStoreDir / HexEncode(name), &content) || content.empty())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    return NonEmptyString(std::move(content));
+  });
+
+  auto start_time(std::chrono::high_resolution_clock::now());
+  ScrubReport report(ScrubDataMaps(data_maps, get_from_store, concurrency));
+  auto stop_time(std::chrono::high_resolution_clock::now());
+  uint64_t duration(
+      std::chrono::duration_cast<std::chrono::microseconds>(stop_time - start_time).count());
+  if (duration == 0)
+    duration = 1;
+
+  for (const auto& name : report.missing_chunks)
+    std::cout << "Missing " << HexEncode(std::string(std::begin(name), std::end(name))) << '\n';
+  for (const auto& name : report.corrupt_chunks)
+    std::cout << "Corrupt " << HexEncode(std::string(std::begin(name), std::end(name))) << '\n';
+  std::cout << "Scrubbed " << report.chunks_checked << " chunks ("
+            << BytesToDecimalSiUnits(report.bytes_checked) << ") from " << data_maps.size()
+            << " data maps in " << (duration / 1000) << " milliseconds at "
+            << (report.chunks_checked * 1000000) / duration << " chunks/s, "
+            << BytesToDecimalSiUnits((report.bytes_checked * 1000000) / duration) << "/s\n"
+            << report.missing_chunks.size() << " missing, " << report.corrupt_chunks.size()
+            << " corrupt\n";
+  return report.missing_chunks.empty() && report.corrupt_chunks.empty() ? kSuccess : kScrubFailed;
+}
+
+}  // namespace tools
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
+
+int main(int argc, char* argv[]) { return maidsafe::encrypt::tools::Scrub(argc, argv); }
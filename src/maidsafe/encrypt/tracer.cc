@@ -0,0 +1,126 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/tracer.h"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <thread>
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/error.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+uint32_t ThreadId() {
+  return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+double Microseconds(Tracer::clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1000.0;
+}
+
+}  // unnamed namespace
+
+const uint32_t Tracer::kNoChunk;
+const size_t Tracer::kBlockSize;
+
+Tracer::Tracer(size_t capacity)
+    : kCapacity_(capacity),
+      kOrigin_(clock::now()),
+      blocks_(new std::atomic<Span*>[(capacity + kBlockSize - 1) / kBlockSize]),
+      next_span_(0),
+      dropped_(0) {
+  if (capacity == 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  for (size_t i(0); i != (kCapacity_ + kBlockSize - 1) / kBlockSize; ++i)
+    blocks_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+Tracer::~Tracer() {
+  for (size_t i(0); i != (kCapacity_ + kBlockSize - 1) / kBlockSize; ++i)
+    delete[] blocks_[i].load(std::memory_order_relaxed);
+}
+
+void Tracer::Record(const char* name, uint32_t chunk, clock::time_point start,
+                    clock::time_point end) {
+  size_t index(next_span_.fetch_add(1, std::memory_order_relaxed));
+  if (index >= kCapacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Span& span(SpanToRecord(index));
+  span.name = name;
+  span.chunk = chunk;
+  span.thread = ThreadId();
+  span.start = start;
+  span.end = end;
+  span.complete.store(true, std::memory_order_release);
+}
+
+size_t Tracer::size() const {
+  return std::min(next_span_.load(std::memory_order_relaxed), kCapacity_);
+}
+
+void Tracer::WriteChromeTrace(std::ostream& output) const {
+  const size_t kSize(size());
+  output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  const char* separator("\n");
+  output << std::fixed << std::setprecision(3);
+  for (size_t i(0); i != kSize; ++i) {
+    // A span's block is published before its index can be complete, so a missing block just means
+    // its spans are still being recorded.
+    const Span* block(blocks_[i / kBlockSize].load(std::memory_order_acquire));
+    if (!block)
+      continue;
+    const Span& span(block[i % kBlockSize]);
+    if (!span.complete.load(std::memory_order_acquire))
+      continue;
+    output << separator << "{\"name\":\"" << span.name << "\",\"cat\":\"encrypt\",\"ph\":\"X\","
+           << "\"pid\":1,\"tid\":" << span.thread
+           << ",\"ts\":" << Microseconds(span.start - kOrigin_)
+           << ",\"dur\":" << Microseconds(span.end - span.start);
+    if (span.chunk != kNoChunk)
+      output << ",\"args\":{\"chunk\":" << span.chunk << '}';
+    output << '}';
+    separator = ",\n";
+  }
+  output << "\n]}\n";
+}
+
+Tracer::Span& Tracer::SpanToRecord(size_t index) {
+  std::atomic<Span*>& slot(blocks_[index / kBlockSize]);
+  Span* block(slot.load(std::memory_order_acquire));
+  if (!block) {
+    // The last block only needs room for what's left of the capacity.
+    std::unique_ptr<Span[]> fresh(
+        new Span[std::min(kBlockSize, kCapacity_ - index / kBlockSize * kBlockSize)]);
+    if (slot.compare_exchange_strong(block, fresh.get(), std::memory_order_acq_rel))
+      block = fresh.release();
+  }
+  return block[index % kBlockSize];
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -0,0 +1,204 @@
+/*  Copyright 2011 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/encrypt/workload_trace.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "boost/exception/all.hpp"
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace encrypt {
+
+namespace {
+
+const char kMagic[] = {'M', 'S', 'W', 'T'};
+const char kVersion(1);
+
+bool HasPosition(WorkloadOperation::Type type) {
+  return type == WorkloadOperation::kWrite || type == WorkloadOperation::kRead ||
+         type == WorkloadOperation::kTruncate;
+}
+
+bool HasLength(WorkloadOperation::Type type) {
+  return type == WorkloadOperation::kWrite || type == WorkloadOperation::kRead;
+}
+
+// Where the next operation is expected to start if the workload is sequential.
+uint64_t EndOf(const WorkloadOperation& operation, uint64_t previous_end) {
+  if (!HasPosition(operation.type))
+    return previous_end;
+  return operation.position + operation.length;
+}
+
+void WriteVarint(uint64_t value, std::ostream& sink) {
+  while (value >= 0x80) {
+    sink.put(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  sink.put(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(std::istream& source) {
+  uint64_t value(0);
+  for (int shift(0); shift < 64; shift += 7) {
+    int next(source.get());
+    if (next == std::char_traits<char>::eof())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    value |= static_cast<uint64_t>(next & 0x7F) << shift;
+    if ((next & 0x80) == 0)
+      return value;
+  }
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // unnamed namespace
+
+bool operator==(const WorkloadOperation& lhs, const WorkloadOperation& rhs) {
+  return lhs.type == rhs.type && lhs.position == rhs.position && lhs.length == rhs.length;
+}
+
+void WriteWorkloadTrace(const std::vector<WorkloadOperation>& operations, std::ostream& sink) {
+  sink.write(kMagic, sizeof(kMagic));
+  sink.put(kVersion);
+  uint64_t previous_end(0);
+  for (const auto& operation : operations) {
+    sink.put(static_cast<char>(operation.type));
+    if (HasPosition(operation.type))
+      WriteVarint(ZigZagEncode(static_cast<int64_t>(operation.position - previous_end)), sink);
+    if (HasLength(operation.type))
+      WriteVarint(operation.length, sink);
+    previous_end = EndOf(operation, previous_end);
+  }
+  if (!sink)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+}
+
+std::vector<WorkloadOperation> ReadWorkloadTrace(std::istream& source) {
+  char header[sizeof(kMagic) + 1];
+  if (!source.read(header, sizeof(header)) ||
+      !std::equal(std::begin(kMagic), std::end(kMagic), header) ||
+      header[sizeof(kMagic)] != kVersion) {
+    LOG(kWarning) << "Not a workload trace, or an unsupported version.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  std::vector<WorkloadOperation> operations;
+  uint64_t previous_end(0);
+  for (int type(source.get()); type != std::char_traits<char>::eof(); type = source.get()) {
+    if (type >= WorkloadOperation::kTypeCount) {
+      LOG(kWarning) << "Unknown operation type " << type << " in workload trace.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    WorkloadOperation operation;
+    operation.type = static_cast<WorkloadOperation::Type>(type);
+    if (HasPosition(operation.type))
+      operation.position = previous_end + ZigZagDecode(ReadVarint(source));
+    if (HasLength(operation.type)) {
+      uint64_t length(ReadVarint(source));
+      if (length > std::numeric_limits<uint32_t>::max())
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      operation.length = static_cast<uint32_t>(length);
+    }
+    previous_end = EndOf(operation, previous_end);
+    operations.push_back(operation);
+  }
+  return operations;
+}
+
+bool WorkloadRecorder::Write(const char* data, uint32_t length, uint64_t position) {
+  operations_.emplace_back(WorkloadOperation::kWrite, position, length);
+  return self_encryptor_.Write(data, length, position);
+}
+
+bool WorkloadRecorder::Read(char* data, uint32_t length, uint64_t position) {
+  operations_.emplace_back(WorkloadOperation::kRead, position, length);
+  return self_encryptor_.Read(data, length, position);
+}
+
+bool WorkloadRecorder::Truncate(uint64_t position) {
+  operations_.emplace_back(WorkloadOperation::kTruncate, position, 0);
+  return self_encryptor_.Truncate(position);
+}
+
+bool WorkloadRecorder::Flush() {
+  operations_.emplace_back(WorkloadOperation::kFlush, 0, 0);
+  return self_encryptor_.Flush();
+}
+
+void WorkloadRecorder::Close() {
+  operations_.emplace_back(WorkloadOperation::kClose, 0, 0);
+  self_encryptor_.Close();
+}
+
+WorkloadLatencies ReplayWorkload(const std::vector<WorkloadOperation>& operations,
+                                 SelfEncryptor& self_encryptor) {
+  uint32_t max_write(0), max_read(0);
+  for (const auto& operation : operations) {
+    if (operation.type == WorkloadOperation::kWrite)
+      max_write = std::max(max_write, operation.length);
+    else if (operation.type == WorkloadOperation::kRead)
+      max_read = std::max(max_read, operation.length);
+  }
+  const std::string kWriteData(RandomString(max_write));
+  std::string read_buffer(max_read, 0);
+
+  WorkloadLatencies latencies;
+  for (const auto& operation : operations) {
+    auto start(std::chrono::steady_clock::now());
+    switch (operation.type) {
+      case WorkloadOperation::kWrite:
+        self_encryptor.Write(kWriteData.data(), operation.length, operation.position);
+        break;
+      case WorkloadOperation::kRead:
+        self_encryptor.Read(&read_buffer[0], operation.length, operation.position);
+        break;
+      case WorkloadOperation::kTruncate:
+        self_encryptor.Truncate(operation.position);
+        break;
+      case WorkloadOperation::kFlush:
+        self_encryptor.Flush();
+        break;
+      default:
+        self_encryptor.Close();
+        break;
+    }
+    latencies[operation.type].push_back(std::chrono::steady_clock::now() - start);
+    if (operation.type == WorkloadOperation::kClose)
+      break;
+  }
+  return latencies;
+}
+
+}  // namespace encrypt
+
+}  // namespace maidsafe
@@ -43,7 +43,8 @@ const size_t kPadSize((3 * crypto::SHA512::DIGESTSIZE) - crypto::AES256_KeySize
 
 class XORFilter : public CryptoPP::Bufferless<CryptoPP::Filter> {
  public:
-  XORFilter(CryptoPP::BufferedTransformation* attachment, byte* pad, size_t pad_size = kPadSize)
+  XORFilter(CryptoPP::BufferedTransformation* attachment, const byte* pad,
+            size_t pad_size = kPadSize)
       : pad_(pad), count_(0), kPadSize_(pad_size) {
     CryptoPP::Filter::Detach(attachment);
   }
@@ -67,7 +68,7 @@ class XORFilter : public CryptoPP::Bufferless<CryptoPP::Filter> {
   bool IsolatedFlush(bool, bool) override { return false; }
 
  private:
-  byte* pad_;
+  const byte* pad_;
   size_t count_;
   const size_t kPadSize_;
 };